@@ -0,0 +1,139 @@
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include "Batch.h"
+#include "Instrument.h"
+#include "SolutionFile.h"
+#include "ThreadPool.h"
+
+void pc::appendGrid(std::string& out, const Grid& picross) {
+    for (unsigned int row = 0; row < picross.getHeight(); row++) {
+        if (row) out += '/';
+        for (unsigned int column = 0; column < picross.getWidth(); column++) {
+            const uint8_t state = picross.get(row, column);
+            out += state == FILLED ? '#' : state == CROSSED ? '.' : '?';
+        }
+    }
+}
+
+pc::BatchSummary pc::solveBatch(PuzzleReader& in, std::ostream& out, const BatchOptions& options) {
+    ThreadPool pool(options.threads);
+    SolveOptions solveOptions = options.solve;
+    solveOptions.threads = 1;
+    solveOptions.pool = nullptr;
+    solveOptions.parallelSweep = false;
+
+    // Per-worker state, reused for every puzzle that worker solves.
+    struct Workspace {
+        Solver solver;
+        SolveOptions options;
+        Grid grid;
+        std::string result, statsLine;
+        SolveStats stats;
+    };
+    std::vector<Workspace> workspaces(pool.size());
+    for (auto& workspace : workspaces) workspace.options = solveOptions;
+
+    std::mutex mutex;
+    std::condition_variable progress;
+    const unsigned long long window = 64 * pool.size();
+    unsigned long long written = 0;
+    BatchSummary summary;
+    // Called with mutex held; may take the contents of result.
+    auto emit = [&](std::string& result) {
+        if (options.solutionsOut) options.solutionsOut->write(result);
+        else out << result;
+    };
+
+    // A puzzle in flight. There are window of them, and the reader only
+    // reads into one taken off the free list, which gets it back once its
+    // puzzle is solved, so their clue storage is reused puzzle after puzzle.
+    struct Slot {
+        Puzzle puzzle;
+        unsigned long long index;
+    };
+    std::vector<Slot> slots(window);
+    std::vector<Slot*> idle;
+    for (auto& slot : slots) idle.push_back(&slot);
+    // Results finished ahead of an earlier puzzle, at their index modulo window.
+    std::vector<std::string> finished(window);
+    std::vector<uint8_t> waiting(window, 0);
+
+    auto solve = [&](Slot& slot) {
+        const Puzzle& puzzle = slot.puzzle;
+        const unsigned long long index = slot.index;
+        Workspace& workspace = workspaces[pool.currentWorker()];
+        SolveStats stats;
+        workspace.grid.resize(puzzle.width, puzzle.height);
+        if (options.timeLimit.count()) workspace.options.deadline = std::chrono::steady_clock::now() + options.timeLimit;
+        const Status status = workspace.solver.solve(workspace.grid, puzzle, workspace.options, &stats);
+        {
+            PC_PHASE(&stats, outputNanos);
+            workspace.result.clear();
+            if (options.solutionsOut) {
+                appendSolutionRecord(workspace.result, index, status, workspace.grid);
+            }
+            else {
+                workspace.result += std::to_string(index);
+                workspace.result += ' ';
+                workspace.result += statusName(status);
+                workspace.result += ' ';
+                appendGrid(workspace.result, workspace.grid);
+                workspace.result += '\n';
+            }
+        }
+        addStats(workspace.stats, stats);
+        if (options.statsOut) {
+            workspace.statsLine = "{\"index\": " + std::to_string(index) + ", \"status\": \"" + statusName(status)
+                                + "\", \"width\": " + std::to_string(puzzle.width)
+                                + ", \"height\": " + std::to_string(puzzle.height);
+            appendStatsJson(workspace.statsLine, stats);
+            workspace.statsLine += "}\n";
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        idle.push_back(&slot);
+        summary.puzzles++;
+        if (status == SOLVED) summary.solved++;
+        else if (status == STUCK) summary.stuck++;
+        else if (status == STOPPED) summary.stopped++;
+        else summary.contradictions++;
+        if (options.statsOut) *options.statsOut << workspace.statsLine;
+        if (!options.ordered || index == written) {
+            emit(workspace.result);
+            written++;
+            for (; waiting[written % window]; written++) {
+                waiting[written % window] = 0;
+                emit(finished[written % window]);
+            }
+        }
+        else {
+            // Swapping hands the workspace the slot's old buffer, so neither reallocates.
+            finished[index % window].swap(workspace.result);
+            waiting[index % window] = 1;
+        }
+        progress.notify_all();
+    };
+
+    unsigned long long index = 0;
+    while (true) {
+        Slot* slot;
+        {
+            // Stay at most window puzzles ahead of the output, which also
+            // bounds how many results wait for an earlier slow puzzle.
+            std::unique_lock<std::mutex> lock(mutex);
+            progress.wait(lock, [&]() { return !idle.empty() && index - written < window; });
+            slot = idle.back();
+            idle.pop_back();
+        }
+        if (!in.next(slot->puzzle)) break;
+        slot->index = index++;
+        // Two pointers fit in the task's own storage: no allocation per puzzle.
+        pool.submit([&solve, slot]() { solve(*slot); });
+    }
+    pool.wait();
+    out.flush();
+    if (options.statsOut) options.statsOut->flush();
+    for (auto& workspace : workspaces) addStats(summary.stats, workspace.stats);
+    return summary;
+}
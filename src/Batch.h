@@ -0,0 +1,66 @@
+/*
+ * Batch.h
+ * Namespace pc: Solves a stream of puzzles on a thread pool.
+ *
+ * The reader stays a bounded number of puzzles ahead of the workers, so
+ * memory does not grow with the length of the stream. Every worker keeps one
+ * Solver and one Grid for the whole batch and reuses them for each puzzle it
+ * picks up, and puzzles are read into a fixed set of slots whose clue storage
+ * is reused too, so once warm a batch allocates nothing per puzzle. Results
+ * are written one line per puzzle:
+ *
+ *   <index> <status> <row>/<row>/...
+ *
+ * with # for a filled cell, . for a crossed one and ? for one left unknown.
+ * Indices count from 0 in input order. A puzzle stopped by its time or step
+ * limit is "stopped", with the cells proven before then.
+ *
+ * Optionally every puzzle also gets one JSON line of solve statistics:
+ *
+ *   {"index": 0, "status": "solved", "width": 5, "height": 5, "line_solves": 14, ...}
+ *
+ * written as each puzzle finishes; see appendStatsJson for the fields.
+ *
+ * With a SolutionWriter, each puzzle becomes one binary record instead of a
+ * text line (see SolutionFile.h), handed to the writer's thread in the same
+ * order the lines would have been written.
+ */
+#pragma once
+#include <ostream>
+#include "Solver.h"
+
+namespace pc {
+    class SolutionWriter;
+
+    struct BatchOptions {
+        unsigned int threads = 1;
+        // Write results in input order; otherwise as soon as each finishes.
+        bool ordered = true;
+        // Options for every puzzle. Each puzzle is solved on a single thread.
+        SolveOptions solve;
+        // Time each puzzle may take before it is stopped; 0 for no limit.
+        std::chrono::milliseconds timeLimit = std::chrono::milliseconds(0);
+        // Where to write the statistics of each puzzle, if anywhere.
+        std::ostream* statsOut = nullptr;
+        // Where to send binary solution records instead of writing text to out.
+        SolutionWriter* solutionsOut = nullptr;
+    };
+
+    struct BatchSummary {
+        unsigned long long puzzles = 0;
+        unsigned long long solved = 0;
+        unsigned long long stuck = 0;
+        unsigned long long contradictions = 0;
+        unsigned long long stopped = 0;
+        SolveStats stats;
+    };
+
+    /*
+     * Solves every puzzle the reader yields. If the reader stops on a
+     * malformed puzzle, its error is left for the caller to report.
+     */
+    BatchSummary solveBatch(PuzzleReader& in, std::ostream& out, const BatchOptions& options);
+
+    // Appends the # . ? rendering of the grid, rows separated by '/'.
+    void appendGrid(std::string& out, const Grid& picross);
+};
@@ -1,127 +1,271 @@
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "Bitmap.h"
 
-bool bm::Array2dToBMP(uint32_t** array, const uint32_t& width, const uint32_t& height, const char* filename) {
-    std::ofstream image(filename, std::ofstream::binary);
-    if (image.fail()) return false;
+static inline void put16(byte* p, uint16_t value) { memcpy(p, &value, 2); }
+static inline void put32(byte* p, uint32_t value) { memcpy(p, &value, 4); }
 
-    // Generate header:
-    int address = 0x7a, sizeOfHeader = 0x6c, paddingPerRow = 4 - ((width * 3) % 4);
-    int imageSize = 3 * (width * height) + (height * paddingPerRow), resolution = 0xb13;
-    int fileSize = address + imageSize;
-    short colorPlanes = 1, bitsPerPixel = 24;
-    image.write("BM", 2 * sizeof(byte)); // header field 0x00
-    image.write((const char*)&fileSize, 4 * sizeof(byte)); // PLACEHOLDER: total size of file in bytes
-    image.write("\0\0\0\0", 4 * sizeof(byte)); // Reserved
-    image.write((const char*)&address, 4 * sizeof(byte)); // Address of pixel data
-    image.write((const char*)&sizeOfHeader, 4 * sizeof(byte)); // Size of header in bytes 0x0E
-    image.write((const char*)&width, 4 * sizeof(byte)); // 0x12
-    image.write((const char*)&height, 4 * sizeof(byte)); // 0x16
-    image.write((const char*)&colorPlanes, 2 * sizeof(byte)); // Number of color planes (must be 1) 0x1A
-    image.write((const char*)&bitsPerPixel, 2 * sizeof(byte)); // 0x1C
-    image.write("\0\0\0\0", 4); // compression method none 0x1E
-    image.write((const char*)&imageSize, 4); // image size: 0x22
-    image.write((const char*)&resolution, 4); // horizontal resolution 0x26
-    image.write((const char*)&resolution, 4); // vertical resolution 0x2A
-    image.write("\0\0\0\0", 4); // num colors in pallete 0x2E
-    image.write("\0\0\0\0", 4); // num of important colors 0x32
-    for (int i = 0; i < 68; i++) image.write("\0", 1 * sizeof(byte));
-
-    // Pixel array: black if 1, white otherwise
-    for (int i = height - 1; i >= 0; i--) {
-        for (int j = 0; j < width; j++) {
-            if (array[i][j] == 1) image.write("\0\0\0", 3);
-            else image.write("\xff\xff\xff", 3);
-        }
-        for (int k = 0; k < paddingPerRow; k++) {
-            image.write("\0", 1);
+/*
+ * Encodes cell row of a BMP with one scale x scale block per cell into line,
+ * stride bytes; isFilled(column) picks black or white so that both grid
+ * representations share one encoder. 24-bit white is 0xff in every channel
+ * and black is 0, so a cell is one memset of 3 * scale bytes.
+ */
+template <typename F>
+static void encodeRow(byte* line, size_t stride, uint32_t width, unsigned int bpp, unsigned int scale, F isFilled) {
+    memset(line, 0, stride);
+    for (uint32_t column = 0; column < width; column++) {
+        const bool filled = isFilled(column);
+        const size_t x = size_t(column) * scale;
+        if (bpp == 24) memset(line + 3 * x, filled ? 0 : 0xff, 3 * scale);
+        else if (filled) {
+            for (size_t bit = x; bit < x + scale; bit++) line[bit >> 3] |= 0x80 >> (bit & 7);
         }
     }
 }
 
-bool bm::AsciiArt(const std::string& filename) {
-    // Open input file in binary mode:
-    std::ifstream data(filename, std::ios_base::binary);
-    data >> std::noskipws; // Don't interpret whitespace
-    if (data.fail()) {
-        std::cout << "Could not open " << filename << "." << std::endl;
-        return false;
+static void encodeGridRow(const pc::Grid& grid, uint32_t row, byte* line, size_t stride, unsigned int bpp, unsigned int scale) {
+    const pc::word* filled = grid.filled(pc::ROWS, row);
+    if (bpp != 1 || scale != 1) {
+        encodeRow(line, stride, grid.getWidth(), bpp, scale, [&](uint32_t column) {
+            return (filled[column / pc::WORD_BITS] >> (column % pc::WORD_BITS)) & 1;
+        });
+        return;
+    }
+    // 1 bpp at scale 1 is the filled plane itself with the bits of every byte
+    // reversed, since the BMP puts the leftmost pixel in the high bit.
+    for (size_t w = 0; w * sizeof(pc::word) < stride; w++) {
+        pc::word bits = w < grid.lineWords(pc::ROWS) ? filled[w] : 0;
+        bits = (bits >> 1 & 0x5555555555555555ull) | (bits & 0x5555555555555555ull) << 1;
+        bits = (bits >> 2 & 0x3333333333333333ull) | (bits & 0x3333333333333333ull) << 2;
+        bits = (bits >> 4 & 0x0f0f0f0f0f0f0f0full) | (bits & 0x0f0f0f0f0f0f0f0full) << 4;
+        memcpy(line + w * sizeof(pc::word), &bits, std::min(sizeof(pc::word), stride - w * sizeof(pc::word)));
     }
+}
+
+/*
+ * Writes a BMP of width x height cells, header included, through
+ * write(data, size). encode(row, line) fills the stride bytes of a cell row,
+ * which are built once and written scale times. Rows go out bottom first, as
+ * the format stores them, through one row buffer, so memory does not grow
+ * with the image; rows are padded to 4 bytes as the format requires.
+ */
+template <typename E, typename W>
+static bool writeBMP(uint32_t width, uint32_t height, unsigned int bpp, unsigned int scale, E encode, W write) {
+    if ((bpp != 1 && bpp != 24) || !scale) return false;
+    const size_t pixelWidth = size_t(width) * scale, pixelHeight = size_t(height) * scale;
+    const size_t stride = ((pixelWidth * bpp + 31) / 32) * 4;
+    const uint32_t paletteSize = bpp == 1 ? 8 : 0, sizeOfHeader = 0x6c, resolution = 0xb13;
+    const uint32_t address = 14 + sizeOfHeader + paletteSize;
+    const size_t imageSize = stride * pixelHeight;
 
-    int numBytesIgnored = 0;
-    auto throwAwayBytes = [&](int numBytes) {
-        byte temp;
-        for (int i = 0; i < numBytes; i++) data >> temp;
-        numBytesIgnored += numBytes;
-    };
-    int numBytesRead = 0;
-
-    // Header: Size is 14 bytes
-    throwAwayBytes(2); // Ignore Signature
-    unsigned int sizeInBytes; data.read((char*)&sizeInBytes, 4); numBytesRead += 4; // 0x02 -> 0x05
-    throwAwayBytes(4); // Ignore reserved space
-    unsigned int startingAddress; data.read((char*)&startingAddress, 4); numBytesRead += 4; // 0x0A -> 0x0D
-
-    // Info Header
-    unsigned int sizeOfHeader; data.read((char*)&sizeOfHeader, 4); numBytesRead += 4; // This represents the size of the info header! 0x0E -> 0x11
-    unsigned int width; data.read((char*)&width, 4); numBytesRead += 4; // 0x12 -> 0x15
-    unsigned int height; data.read((char*)&height, 4); numBytesRead += 4; // 0x16 -> 0x19
-    throwAwayBytes(2);
-    unsigned short bpp; data.read((char*)&bpp, 2); numBytesRead += 2; // 0x1C -> 0x1D 30 bytes total
-    unsigned short bytesPerPixel = bpp / 8;
-    throwAwayBytes(4);
-    unsigned int imageSize; data.read((char*)&imageSize, 4); numBytesRead += 4; // 0x22 -> 0x25 38 bytes total
-    throwAwayBytes(startingAddress - numBytesIgnored - numBytesRead);
-
-    auto calculatePadding = [&]() {
-        if (!((width * bytesPerPixel) % 4)) return 0;
-        int padding = 1;
-        while (((width * bytesPerPixel) + padding) % 4) padding++;
-        return padding;
-    };
-
-    int padding = calculatePadding();
-    size_t arrSize = imageSize * sizeof(byte) - (height * padding);
-    byte* pixelData = new byte[arrSize];
-    for (unsigned int i = 0; i < arrSize; i++) {
-        pixelData[i] = 69;
+    byte header[14 + 0x6c + 8] = {};
+    byte* p = header;
+    p[0] = 'B'; p[1] = 'M';                          // header field 0x00
+    put32(p + 0x02, address + imageSize);            // total size of file in bytes
+    put32(p + 0x0a, address);                        // address of pixel data
+    put32(p + 0x0e, sizeOfHeader);                   // size of info header
+    put32(p + 0x12, pixelWidth);
+    put32(p + 0x16, pixelHeight);
+    put16(p + 0x1a, 1);                              // number of color planes (must be 1)
+    put16(p + 0x1c, bpp);
+    put32(p + 0x22, imageSize);                      // compression none at 0x1e
+    put32(p + 0x26, resolution);                     // horizontal resolution
+    put32(p + 0x2a, resolution);                     // vertical resolution
+    if (bpp == 1) {
+        put32(p + 0x2e, 2);                          // num colors in palette
+        // Palette: index 0 white, index 1 black, so a set bit is a filled cell.
+        memset(p + 14 + sizeOfHeader, 0xff, 3);
     }
+    if (!write(header, address)) return false;
 
-    byte temp;
-    for (unsigned int i = 0; i < height; i++) {
-        for (unsigned int j = 0; j < width * bytesPerPixel; j++) {
-            data.read((char*)&temp, 1);
-            pixelData[i * (width * bytesPerPixel) + j] = temp;
+    std::vector<byte> line(stride);
+    for (uint32_t row = height; row-- > 0;) {
+        encode(row, line.data(), stride);
+        for (unsigned int copy = 0; copy < scale; copy++) {
+            if (!write(line.data(), stride)) return false;
         }
-        for (int j = 0; j < padding; j++) data.read((char*)&temp, 1);
     }
+    return true;
+}
 
-    data.close();
+// Streams the BMP into filename a row at a time.
+template <typename E>
+static bool writeFile(const char* filename, uint32_t width, uint32_t height, unsigned int bpp, unsigned int scale, E encode) {
+    if ((bpp != 1 && bpp != 24) || !scale) return false;
+    std::ofstream image(filename, std::ofstream::binary);
+    if (image.fail()) return false;
+    const bool written = writeBMP(width, height, bpp, scale, encode, [&](const byte* data, size_t size) {
+        image.write((const char*)data, size);
+        return image.good();
+    });
+    image.close();
+    return written && !image.fail();
+}
+
+bool bm::encodeBMP(const pc::Grid& grid, std::vector<byte>& out, unsigned int bpp, unsigned int scale) {
+    out.clear();
+    return writeBMP(grid.getWidth(), grid.getHeight(), bpp, scale,
+        [&](uint32_t row, byte* line, size_t stride) { encodeGridRow(grid, row, line, stride, bpp, scale); },
+        [&](const byte* data, size_t size) {
+            out.insert(out.end(), data, data + size);
+            return true;
+        });
+}
+
+bool bm::Array2dToBMP(uint32_t** array, const uint32_t& width, const uint32_t& height, const char* filename,
+                      unsigned int bpp, unsigned int scale) {
+    return writeFile(filename, width, height, bpp, scale, [&](uint32_t row, byte* line, size_t stride) {
+        encodeRow(line, stride, width, bpp, scale, [&](uint32_t column) { return array[row][column] == 1; });
+    });
+}
+
+bool bm::Array2dToBMP(const pc::Grid& grid, const char* filename, unsigned int bpp, unsigned int scale) {
+    return writeFile(filename, grid.getWidth(), grid.getHeight(), bpp, scale,
+        [&](uint32_t row, byte* line, size_t stride) { encodeGridRow(grid, row, line, stride, bpp, scale); });
+}
 
-    unsigned int numPixels = (imageSize - (padding * height)) / bytesPerPixel;
-    bm::Pixel* pixels = new bm::Pixel[numPixels];
+static inline uint16_t get16(const byte* p) { uint16_t value; memcpy(&value, p, 2); return value; }
+static inline uint32_t get32(const byte* p) { uint32_t value; memcpy(&value, p, 4); return value; }
 
-    for (unsigned int i = 0; i < numPixels; i++) {
-        byte* currentPixelData = new byte[bytesPerPixel];
-        for (unsigned int j = 0; j < bytesPerPixel; j++) {
-            currentPixelData[j] = pixelData[(i * bytesPerPixel) + j];
+bm::BMPReader::BMPReader() : fd(-1), mapping(nullptr), size(0) {}
+
+bm::BMPReader::~BMPReader() {
+    this->close();
+}
+
+bool bm::BMPReader::fail(const std::string& message) {
+    this->error = message;
+    this->image = Image();
+    return false;
+}
+
+bool bm::BMPReader::open(const char* filename) {
+    this->close();
+    this->fd = ::open(filename, O_RDONLY);
+    if (this->fd < 0) return this->fail(std::string("could not open ") + filename);
+    struct stat info;
+    if (!fstat(this->fd, &info) && S_ISREG(info.st_mode) && info.st_size > 0) {
+        void* mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, this->fd, 0);
+        if (mapped != MAP_FAILED) {
+            this->mapping = mapped;
+            this->size = info.st_size;
+            return this->parse((const byte*)mapped, this->size);
         }
-        pixels[i] = bm::Pixel(bytesPerPixel);
-        pixels[i].setRGBA(currentPixelData);
     }
+    // Not mappable (pipe, device): read it whole, in as few calls as possible.
+    this->buffer.resize(1 << 16);
+    size_t got = 0;
+    while (true) {
+        if (got == this->buffer.size()) this->buffer.resize(2 * this->buffer.size());
+        const ssize_t bytes = read(this->fd, &this->buffer[0] + got, this->buffer.size() - got);
+        if (bytes <= 0) break;
+        got += bytes;
+    }
+    return this->parse(this->buffer.data(), got);
+}
+
+bool bm::BMPReader::open(const byte* data, size_t size) {
+    this->close();
+    return this->parse(data, size);
+}
+
+void bm::BMPReader::close() {
+    if (this->mapping) munmap(this->mapping, this->size);
+    if (this->fd >= 0) ::close(this->fd);
+    this->fd = -1;
+    this->mapping = nullptr;
+    this->size = 0;
+    this->image = Image();
+    this->error.clear();
+}
+
+bool bm::BMPReader::parse(const byte* data, size_t size) {
+    // File header (14 bytes) then at least the 40-byte BITMAPINFOHEADER.
+    if (size < 54 || data[0] != 'B' || data[1] != 'M') return this->fail("not a BMP file");
+    const uint32_t address = get32(data + 0x0a), sizeOfHeader = get32(data + 0x0e);
+    const int32_t width = get32(data + 0x12), height = get32(data + 0x16);
+    const unsigned int bpp = get16(data + 0x1c), compression = get32(data + 0x1e);
+    if (sizeOfHeader < 40 || width <= 0 || height == 0) return this->fail("unsupported BMP header");
+    if (bpp != 1 && bpp != 8 && bpp != 24 && bpp != 32) return this->fail("unsupported bits per pixel");
+    // Only uncompressed pixels; 32-bit files often say BI_BITFIELDS for plain BGRA.
+    if (compression != 0 && !(compression == 3 && bpp == 32)) return this->fail("compressed BMP files are not supported");
 
-    std::string str = " ^\",:;Il!i~+_-?][}{1)(|\\/tfjrxnuvczXYUJCLQ0OZmwqpdbkhao*#MW&8%B@$";
-    const float divider = (255.0f / (float)str.length());
+    Image& image = this->image;
+    image.width = width;
+    image.height = height < 0 ? -int64_t(height) : height;
+    image.bpp = bpp;
+    image.stride = ((size_t(image.width) * bpp + 31) / 32) * 4;
+    if (!image.stride || !image.height) return this->fail("unsupported BMP header");
+    // Divide rather than multiply, so a huge height cannot wrap the product.
+    if (address > size || image.height > (size - address) / image.stride) return this->fail("truncated BMP file");
+    if (bpp <= 8) {
+        uint32_t colors = get32(data + 0x2e);
+        if (!colors || colors > (1u << bpp)) colors = 1u << bpp;
+        if (14 + sizeOfHeader + 4 * size_t(colors) > address) return this->fail("truncated BMP palette");
+        image.palette = data + 14 + sizeOfHeader;
+        image.colors = colors;
+    }
+    // Point first at the top row; rows are bottom-up unless the height is negative.
+    image.first = data + address + (height > 0 ? image.stride * (image.height - 1) : 0);
+    image.step = height > 0 ? -ptrdiff_t(image.stride) : ptrdiff_t(image.stride);
+    return true;
+}
 
-    for (int i = height - 1; i >= 0; i--) {
-        for (unsigned int j = 0; j < width; j++) {
-            unsigned int arrIndex = pixels[i * width + j].getAverage() / divider;
-            arrIndex = (arrIndex == str.length() ? arrIndex - 1 : arrIndex);
-            std::cout << str[arrIndex];
+/*
+ * Integer Rec. 601 luma, (77 R + 150 G + 29 B) / 256, for every pixel of the
+ * row in one pass. Palette images look their colors up once per row.
+ */
+void bm::rowLuminance(const Image& image, uint32_t y, byte* out) {
+    auto luma = [](const byte* bgr) { return byte((29 * bgr[0] + 150 * bgr[1] + 77 * bgr[2]) >> 8); };
+    const byte* row = image.row(y);
+    const uint32_t width = image.width;
+    switch (image.bpp) {
+        case 24:
+            for (uint32_t x = 0; x < width; x++, row += 3) out[x] = luma(row);
+            break;
+        case 32:
+            for (uint32_t x = 0; x < width; x++, row += 4) out[x] = luma(row);
+            break;
+        default: {
+            byte shades[256];
+            for (unsigned int i = 0; i < image.colors; i++) shades[i] = luma(image.palette + 4 * i);
+            for (unsigned int i = image.colors; i < 256; i++) shades[i] = 0;
+            if (image.bpp == 8) {
+                for (uint32_t x = 0; x < width; x++) out[x] = shades[row[x]];
+            }
+            else {
+                for (uint32_t x = 0; x < width; x++) out[x] = shades[(row[x >> 3] >> (7 - (x & 7))) & 1];
+            }
         }
-        std::cout << std::endl;
     }
+}
+
+bool bm::AsciiArt(const std::string& filename) {
+    BMPReader reader;
+    if (!reader.open(filename.c_str())) {
+        std::cout << "Could not open " << filename << ": " << reader.getError() << "." << std::endl;
+        return false;
+    }
+    const Image& image = reader.getImage();
 
-    delete[] pixels;
-    delete[] pixelData;
+    // Darkest to brightest, looked up by luminance through a 256-entry table.
+    static const char ramp[] = " ^\",:;Il!i~+_-?][}{1)(|\\/tfjrxnuvczXYUJCLQ0OZmwqpdbkhao*#MW&8%B@$";
+    const unsigned int length = sizeof(ramp) - 1;
+    char shade[256];
+    for (unsigned int i = 0; i < 256; i++) shade[i] = ramp[std::min(i * length / 255, length - 1)];
+
+    std::vector<byte> luminance(image.width);
+    std::string line(image.width + 1, '\n');
+    for (uint32_t y = 0; y < image.height; y++) {
+        bm::rowLuminance(image, y, luminance.data());
+        for (uint32_t x = 0; x < image.width; x++) line[x] = shade[luminance[x]];
+        std::cout.write(line.data(), line.size());
+    }
+    std::cout.flush();
     return true;
 }
@@ -4,31 +4,79 @@
  */
 #pragma once
 #include <iostream>
+#include <cstddef>
+#include <cstdint>
 #include <fstream>
+#include <string>
+#include <vector>
+#include "Grid.h"
 
 typedef unsigned char byte;
 
 namespace bm {
-    struct Pixel {
+    /*
+     * View of the pixel rows of a BMP file. row(y) is the y-th row from the
+     * top whichever way round the file stores them; rows are stride bytes
+     * apart and hold bpp bits per pixel. 1 and 8 bpp images index palette,
+     * which holds colors BGRX entries.
+     */
+    struct Image {
+        uint32_t width = 0, height = 0;
+        size_t stride = 0;
+        unsigned int bpp = 0, colors = 0;
+        const byte* palette = nullptr;
+        const byte* first = nullptr;
+        ptrdiff_t step = 0;
+
+        inline const byte* row(uint32_t y) const { return this->first + this->step * ptrdiff_t(y); }
+    };
+
+    /*
+     * Opens an uncompressed 1, 8, 24 or 32 bpp BMP file by mapping it, or
+     * with one read when it cannot be mapped. The image views the mapping,
+     * so it is valid until the reader is closed or reopened.
+     */
+    class BMPReader {
         public:
-            Pixel() : rgba(nullptr) {}
-            Pixel(unsigned int bytesPerPixel)
-                : bytesPerPixel(bytesPerPixel)
-            {
-                this->rgba = new byte[bytesPerPixel];
-            }
-            ~Pixel() {
-                if (this->rgba) delete[] this->rgba;
-            }
-            inline void setRGBA(byte* rgba) { this->rgba = rgba; }
-            inline byte* getRGBA() const { return this->rgba; }
-            unsigned int getAverage() const {
-                return (rgba[bytesPerPixel - 1] + rgba[bytesPerPixel - 2] + rgba[bytesPerPixel - 3]) / 3;
-            }
+            BMPReader();
+            ~BMPReader();
+            BMPReader(const BMPReader&) = delete;
+            BMPReader& operator=(const BMPReader&) = delete;
+
+            // False if the file cannot be read or is not a supported BMP; getError() says why.
+            bool open(const char* filename);
+            // Reads from memory that must outlive the reader.
+            bool open(const byte* data, size_t size);
+            void close();
+
+            inline const Image& getImage() const { return this->image; }
+            inline const std::string& getError() const { return this->error; }
+
         private:
-            unsigned int bytesPerPixel;
-            byte* rgba;
+            bool parse(const byte* data, size_t size);
+            bool fail(const std::string& message);
+
+            int fd;
+            void* mapping;
+            size_t size;
+            std::vector<byte> buffer; // Whole file when it could not be mapped.
+            Image image;
+            std::string error;
     };
-    bool Array2dToBMP(uint32_t** array, const uint32_t& width, const uint32_t& height, const char* filename);
+
+    // Writes the 0-255 luminance of every pixel of row y, top first, into out[0, width).
+    void rowLuminance(const Image& image, uint32_t y, byte* out);
+
+    /*
+     * Writes a grid as a black and white BMP: bpp is 24 (RGB) or 1 (two-entry
+     * palette, 24 times smaller), and every cell becomes a scale x scale block.
+     * Rows are encoded and written one at a time, bottom first, so writing
+     * takes one row of memory however large the image.
+     */
+    bool Array2dToBMP(uint32_t** array, const uint32_t& width, const uint32_t& height, const char* filename,
+                      unsigned int bpp = 24, unsigned int scale = 1);
+    bool Array2dToBMP(const pc::Grid& grid, const char* filename, unsigned int bpp = 24, unsigned int scale = 1);
+    // Encodes the BMP file into out, reusing its storage; false on a bad bpp or scale.
+    bool encodeBMP(const pc::Grid& grid, std::vector<byte>& out, unsigned int bpp = 24, unsigned int scale = 1);
     bool AsciiArt(const std::string& filename);
 };
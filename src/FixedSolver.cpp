@@ -0,0 +1,33 @@
+#include "FixedSolver.h"
+
+namespace {
+    template <unsigned int W, unsigned int H>
+    pc::Status solveWith(pc::Grid& picross, const pc::ClueList& rows, const pc::ClueList& columns,
+                         const pc::SolveOptions& options, pc::SolveStats& stats, pc::SolveBudget* budget) {
+        pc::FixedSolver<W, H> solver;
+        solver.load(rows, columns);
+        return solver.solve(picross, options, stats, budget);
+    }
+
+    constexpr uint64_t sizeKey(unsigned int width, unsigned int height) {
+        return uint64_t(width) << 32 | height;
+    }
+}
+
+bool pc::solveFixedSize(Grid& picross, const pc::ClueList& rows, const pc::ClueList& columns,
+                        const SolveOptions& options, SolveStats& stats, SolveBudget* budget, Status& status) {
+    if (options.threads > 1 || options.pool || options.lineCache) return false;
+    // Width and height each take 32 bits of the key, so no two sizes share one.
+    switch (sizeKey(picross.getWidth(), picross.getHeight())) {
+        case sizeKey(5, 5): status = solveWith<5, 5>(picross, rows, columns, options, stats, budget); return true;
+        case sizeKey(5, 10): status = solveWith<5, 10>(picross, rows, columns, options, stats, budget); return true;
+        case sizeKey(5, 15): status = solveWith<5, 15>(picross, rows, columns, options, stats, budget); return true;
+        case sizeKey(10, 5): status = solveWith<10, 5>(picross, rows, columns, options, stats, budget); return true;
+        case sizeKey(10, 10): status = solveWith<10, 10>(picross, rows, columns, options, stats, budget); return true;
+        case sizeKey(10, 15): status = solveWith<10, 15>(picross, rows, columns, options, stats, budget); return true;
+        case sizeKey(15, 5): status = solveWith<15, 5>(picross, rows, columns, options, stats, budget); return true;
+        case sizeKey(15, 10): status = solveWith<15, 10>(picross, rows, columns, options, stats, budget); return true;
+        case sizeKey(15, 15): status = solveWith<15, 15>(picross, rows, columns, options, stats, budget); return true;
+    }
+    return false;
+}
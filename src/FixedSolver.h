@@ -0,0 +1,344 @@
+/*
+ * FixedSolver.h
+ * Namespace pc: Solvers specialized at compile time for small puzzle sizes.
+ *
+ * Most puzzles are 5x5, 10x10 or 15x15, and at those sizes every line fits in
+ * 16 bits and the whole solve state fits in a few hundred bytes. FixedSolver
+ * keeps that state in std::arrays sized by its template arguments, so nothing
+ * is allocated and every loop over lines has a constant trip count.
+ *
+ * Lines are solved by table instead of by the line kernel: LinePatterns<N>,
+ * built entirely at compile time, lists all 2^N fillings of an N-cell line
+ * ordered by the clues they produce. A clue's fillings are then one
+ * contiguous range, found once per puzzle, and solving a line is a scan of
+ * that range for the fillings that agree with the known cells.
+ *
+ * Search, when enabled, branches exactly like Search (same cell choice, filled
+ * before crossed), so it finds the same solutions in the same order; a branch
+ * is a copy of the state on the stack instead of an undo trail.
+ */
+#pragma once
+#include <array>
+#include <cstdint>
+#include <vector>
+#include "Grid.h"
+#include "Solver.h"
+
+namespace pc {
+    // Longest line a fixed-size solver takes; its table has 2^15 entries.
+    const unsigned int FIXED_MAX_LENGTH = 15;
+
+    // Clues that fit in an N-cell line, the empty clue included: Fibonacci(N + 2).
+    constexpr unsigned int clueCount(unsigned int n) {
+        unsigned int a = 1, b = 1;
+        for (unsigned int i = 0; i < n; i++) {
+            const unsigned int next = a + b;
+            a = b;
+            b = next;
+        }
+        return b;
+    }
+
+    /*
+     * Every filling of an N-cell line, grouped by the clues it produces, plus
+     * an index from clue to its group sorted by clue code: the runs, first run
+     * in the lowest four bits. Runs are at least 1, so no two clues share a
+     * code.
+     *
+     * The groups are generated clue by clue, each by placing the blocks left
+     * to right, and the clues in increasing code order: fewer runs first,
+     * then by the last run, the one before it and so on. Nothing is sorted,
+     * which would exceed the compiler's constexpr step limit at N = 15.
+     */
+    template <unsigned int N>
+    struct LinePatterns {
+        static constexpr unsigned int COUNT = 1u << N, CLUES = clueCount(N);
+        uint16_t pattern[COUNT];
+        uint32_t code[CLUES];
+        uint16_t begin[CLUES], size[CLUES];
+
+        constexpr LinePatterns() : pattern(), code(), begin(), size(), patterns(0), clues(0), runs() {
+            for (unsigned int count = 0; 2 * count <= N + 1; count++) this->addClues(count, count, 0);
+        }
+
+        // Index of the clue with this code, or CLUES if no clue has it.
+        constexpr unsigned int find(uint32_t key) const {
+            unsigned int low = 0, high = CLUES;
+            while (low < high) {
+                const unsigned int middle = (low + high) / 2;
+                if (this->code[middle] < key) low = middle + 1;
+                else high = middle;
+            }
+            return low < CLUES && this->code[low] == key ? low : CLUES;
+        }
+
+        private:
+            /*
+             * Every clue of count runs that ends in runs[below..count), taking
+             * used cells so far, in increasing code order.
+             */
+            constexpr void addClues(unsigned int count, unsigned int below, unsigned int used) {
+                if (!below) {
+                    uint32_t key = 0;
+                    for (unsigned int r = 0; r < count; r++) key |= this->runs[r] << (4 * r);
+                    this->code[this->clues] = key;
+                    this->begin[this->clues] = this->patterns;
+                    this->addPlacements(count, 0, 0, 0);
+                    this->size[this->clues] = this->patterns - this->begin[this->clues];
+                    this->clues++;
+                    return;
+                }
+                // The below - 1 runs still to choose need a cell and a gap each.
+                const unsigned int gap = below < count ? 1 : 0, reserve = 2 * (below - 1);
+                for (unsigned int run = 1; used + gap + run + reserve <= N; run++) {
+                    this->runs[below - 1] = run;
+                    this->addClues(count, below - 1, used + gap + run);
+                }
+            }
+
+            // Every placement of runs[block..count) at or after cell from.
+            constexpr void addPlacements(unsigned int count, unsigned int block, unsigned int from, uint32_t bits) {
+                if (block == count) {
+                    this->pattern[this->patterns++] = bits;
+                    return;
+                }
+                unsigned int rest = 0;
+                for (unsigned int r = block + 1; r < count; r++) rest += this->runs[r] + 1;
+                const unsigned int run = this->runs[block];
+                for (unsigned int start = from; start + run + rest <= N; start++) {
+                    this->addPlacements(count, block + 1, start + run + 1, bits | (((1u << run) - 1) << start));
+                }
+            }
+
+            unsigned int patterns, clues;
+            uint32_t runs[N];
+    };
+
+    template <unsigned int N>
+    constexpr LinePatterns<N> linePatterns{};
+
+    template <unsigned int W, unsigned int H>
+    class FixedSolver {
+        static_assert(W && H && W <= FIXED_MAX_LENGTH && H <= FIXED_MAX_LENGTH, "FixedSolver lines are 1 to 15 cells");
+
+        public:
+            // Finds the pattern range of every line's clues.
+            void load(const ClueList& rows, const ClueList& columns) {
+                for (unsigned int row = 0; row < H; row++) this->rowRange[row] = findRange<W>(rows[row]);
+                for (unsigned int column = 0; column < W; column++) this->columnRange[column] = findRange<H>(columns[column]);
+            }
+
+            /*
+             * Solves from the cells already known in picross, a W x H grid, and
+             * adds what it deduces, or the first solution, to it. Behaves as
+             * Solver::solve with the same options on a single thread.
+             */
+            Status solve(Grid& picross, const SolveOptions& options, SolveStats& stats, SolveBudget* budget) {
+                State state;
+                for (unsigned int row = 0; row < H; row++) {
+                    state.rowFilled[row] = picross.filled(ROWS, row)[0];
+                    state.rowCrossed[row] = picross.crossed(ROWS, row)[0];
+                }
+                for (unsigned int column = 0; column < W; column++) {
+                    state.columnFilled[column] = picross.filled(COLUMNS, column)[0];
+                    state.columnCrossed[column] = picross.crossed(COLUMNS, column)[0];
+                }
+                stats.linesQueued += W + H;
+                const unsigned long long before = stats.lineSolves;
+                const Status status = this->propagate(state, ROW_LINES, COLUMN_LINES, stats);
+                store(state, picross);
+                if (!options.search || status == CONTRADICTION) {
+                    if (budget) budget->spend(stats.lineSolves - before, picross);
+                    return status;
+                }
+                // The first node reports the root's line solves.
+                Context context{options, stats, picross, 0, budget, before};
+                this->node(state, 0, 0, context);
+                // And this the ones made since the last node that checked the budget.
+                if (budget) budget->spend(stats.lineSolves - context.reported, picross);
+                if (!context.found && budget && budget->stopped()) return STOPPED;
+                return context.found ? SOLVED : CONTRADICTION;
+            }
+
+        private:
+            static constexpr uint32_t ROW_MASK = (1u << W) - 1, COLUMN_MASK = (1u << H) - 1;
+            static constexpr uint32_t ROW_LINES = (1u << H) - 1, COLUMN_LINES = (1u << W) - 1;
+
+            struct State {
+                std::array<uint32_t, H> rowFilled, rowCrossed;
+                std::array<uint32_t, W> columnFilled, columnCrossed;
+            };
+            struct Range {
+                uint32_t begin, end;
+            };
+            struct Context {
+                const SolveOptions& options;
+                SolveStats& stats;
+                Grid& picross;
+                unsigned long long found;
+                SolveBudget* budget;
+                unsigned long long reported; // stats.lineSolves last passed to the budget.
+            };
+
+            // The fillings of an N-cell line that match clues; empty if none can.
+            template <unsigned int N>
+            static Range findRange(ClueLine clues) {
+                const LinePatterns<N>& table = linePatterns<N>;
+                uint32_t key = 0;
+                unsigned int count = 0;
+                for (unsigned int clue : clues) {
+                    if (!clue) continue;
+                    // Another run needs it and a gap before it; 2 * count > N - 1
+                    // also keeps the key within 32 bits.
+                    if (clue > N || 2 * count >= N) return {0, 0};
+                    key |= clue << (4 * count++);
+                }
+                const unsigned int index = table.find(key);
+                if (index == table.CLUES) return {0, 0};
+                return {table.begin[index], uint32_t(table.begin[index] + table.size[index])};
+            }
+
+            /*
+             * The cells every filling in range that agrees with the line puts
+             * in filled and crossed; false if none agrees.
+             */
+            template <unsigned int N>
+            static bool solveLine(const Range& range, uint32_t& filled, uint32_t& crossed) {
+                const LinePatterns<N>& table = linePatterns<N>;
+                const uint32_t mask = (1u << N) - 1;
+                uint32_t always = mask, ever = 0;
+                for (uint32_t p = range.begin; p < range.end; p++) {
+                    const uint32_t pattern = table.pattern[p];
+                    if ((pattern & crossed) || (filled & ~pattern)) continue;
+                    always &= pattern;
+                    ever |= pattern;
+                }
+                // Nothing agreed: always is still the whole line.
+                if (always & ~ever) return false;
+                filled |= always;
+                crossed |= mask & ~ever;
+                return true;
+            }
+
+            Status propagate(State& state, uint32_t rowsDirty, uint32_t columnsDirty, SolveStats& stats) const {
+                while (rowsDirty | columnsDirty) {
+                    for (uint32_t m = rowsDirty; m; m &= m - 1) {
+                        const unsigned int row = __builtin_ctz(m);
+                        uint32_t filled = state.rowFilled[row], crossed = state.rowCrossed[row];
+                        stats.lineSolves++;
+                        if (!solveLine<W>(this->rowRange[row], filled, crossed)) return CONTRADICTION;
+                        const uint32_t newFilled = filled & ~state.rowFilled[row], newCrossed = crossed & ~state.rowCrossed[row];
+                        if (!(newFilled | newCrossed)) continue;
+                        state.rowFilled[row] = filled;
+                        state.rowCrossed[row] = crossed;
+                        for (uint32_t c = newFilled; c; c &= c - 1) state.columnFilled[__builtin_ctz(c)] |= 1u << row;
+                        for (uint32_t c = newCrossed; c; c &= c - 1) state.columnCrossed[__builtin_ctz(c)] |= 1u << row;
+                        columnsDirty |= newFilled | newCrossed;
+                        stats.cellsChanged += __builtin_popcount(newFilled | newCrossed);
+                    }
+                    rowsDirty = 0;
+                    for (uint32_t m = columnsDirty; m; m &= m - 1) {
+                        const unsigned int column = __builtin_ctz(m);
+                        uint32_t filled = state.columnFilled[column], crossed = state.columnCrossed[column];
+                        stats.lineSolves++;
+                        if (!solveLine<H>(this->columnRange[column], filled, crossed)) return CONTRADICTION;
+                        const uint32_t newFilled = filled & ~state.columnFilled[column];
+                        const uint32_t newCrossed = crossed & ~state.columnCrossed[column];
+                        if (!(newFilled | newCrossed)) continue;
+                        state.columnFilled[column] = filled;
+                        state.columnCrossed[column] = crossed;
+                        for (uint32_t r = newFilled; r; r &= r - 1) state.rowFilled[__builtin_ctz(r)] |= 1u << column;
+                        for (uint32_t r = newCrossed; r; r &= r - 1) state.rowCrossed[__builtin_ctz(r)] |= 1u << column;
+                        rowsDirty |= newFilled | newCrossed;
+                        stats.cellsChanged += __builtin_popcount(newFilled | newCrossed);
+                    }
+                    columnsDirty = 0;
+                }
+                for (unsigned int row = 0; row < H; row++) {
+                    if ((state.rowFilled[row] | state.rowCrossed[row]) != ROW_MASK) return STUCK;
+                }
+                return SOLVED;
+            }
+
+            // One search node, as Search::node; returns true once the search should stop.
+            bool node(State& state, uint32_t rowsDirty, uint32_t columnsDirty, Context& context) const {
+                SolveStats& stats = context.stats;
+                if (context.budget) {
+                    // Progress reports see the root grid: the search state is not a Grid.
+                    const bool stop = context.budget->spend(stats.lineSolves - context.reported, context.picross);
+                    context.reported = stats.lineSolves;
+                    if (stop) return true;
+                }
+                stats.searchNodes++;
+                const Status status = this->propagate(state, rowsDirty, columnsDirty, stats);
+                if (status == CONTRADICTION) {
+                    stats.backtracks++;
+                    return false;
+                }
+                if (status == SOLVED) {
+                    const SolveOptions& options = context.options;
+                    stats.solutions++;
+                    if (!context.found++) store(state, context.picross);
+                    if (options.onSolution) {
+                        // The callback wants a Grid; only this path allocates.
+                        Grid solution(W, H);
+                        store(state, solution);
+                        if (!options.onSolution(solution)) return true;
+                    }
+                    return options.solutionLimit && context.found >= options.solutionLimit;
+                }
+
+                // Search::chooseCell: the first unknown cell of the line with
+                // the fewest unknown cells, columns before rows.
+                unsigned int bestUnknown = ~0u, row = 0, column = 0;
+                for (unsigned int c = 0; c < W; c++) {
+                    const unsigned int unknown = H - __builtin_popcount(state.columnFilled[c] | state.columnCrossed[c]);
+                    if (unknown && unknown < bestUnknown) {
+                        bestUnknown = unknown;
+                        column = c;
+                        row = __builtin_ctz(~(state.columnFilled[c] | state.columnCrossed[c]));
+                    }
+                }
+                for (unsigned int r = 0; r < H; r++) {
+                    const unsigned int unknown = W - __builtin_popcount(state.rowFilled[r] | state.rowCrossed[r]);
+                    if (unknown && unknown < bestUnknown) {
+                        bestUnknown = unknown;
+                        row = r;
+                        column = __builtin_ctz(~(state.rowFilled[r] | state.rowCrossed[r]));
+                    }
+                }
+                for (int guess = 0; guess < 2; guess++) {
+                    State branch = state;
+                    if (!guess) {
+                        branch.rowFilled[row] |= 1u << column;
+                        branch.columnFilled[column] |= 1u << row;
+                    }
+                    else {
+                        branch.rowCrossed[row] |= 1u << column;
+                        branch.columnCrossed[column] |= 1u << row;
+                    }
+                    if (this->node(branch, 1u << row, 1u << column, context)) return true;
+                }
+                return false;
+            }
+
+            static void store(const State& state, Grid& picross) {
+                for (unsigned int row = 0; row < H; row++) {
+                    const word filled = state.rowFilled[row], crossed = state.rowCrossed[row];
+                    picross.merge(ROWS, row, &filled, &crossed);
+                }
+            }
+
+            std::array<Range, H> rowRange;
+            std::array<Range, W> columnRange;
+    };
+
+    /*
+     * Runs Solver::solve through a FixedSolver when one is built for the
+     * puzzle's size (5, 10 or 15 cells each way) and the options ask for a
+     * single thread and no line cache; false, with nothing done, otherwise.
+     * The budget, if any, is checked at every search node.
+     */
+    bool solveFixedSize(Grid& picross, const ClueList& rows, const ClueList& columns,
+                        const SolveOptions& options, SolveStats& stats, SolveBudget* budget, Status& status);
+};
@@ -0,0 +1,224 @@
+#include <algorithm>
+#include <condition_variable>
+#include <dirent.h>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sys/stat.h>
+#include "Generator.h"
+#include "ThreadPool.h"
+
+void pc::PuzzleGenerator::imageToGrid(const bm::Image& image, unsigned int width, unsigned int height,
+                                      unsigned int threshold, Grid& picross) {
+    picross.resize(width, height);
+    this->luminance.resize(image.width);
+    this->prefix.resize(image.width + 1);
+    this->sums.resize(width);
+    this->counts.resize(width);
+    this->filled.resize(wordsFor(width));
+    this->crossed.resize(wordsFor(width));
+
+    // Cell i covers source pixels [i * size / cells, (i + 1) * size / cells),
+    // widened to at least one pixel when the grid is larger than the image.
+    auto span = [](unsigned int i, unsigned int cells, unsigned int size, unsigned int& begin, unsigned int& end) {
+        begin = uint64_t(i) * size / cells;
+        end = std::max(begin + 1, unsigned(uint64_t(i + 1) * size / cells));
+    };
+
+    this->prefix[0] = 0;
+    for (unsigned int row = 0; row < height; row++) {
+        std::fill(this->sums.begin(), this->sums.end(), 0);
+        unsigned int top, bottom;
+        span(row, height, image.height, top, bottom);
+        for (unsigned int y = top; y < bottom; y++) {
+            bm::rowLuminance(image, y, this->luminance.data());
+            for (unsigned int x = 0; x < image.width; x++) this->prefix[x + 1] = this->prefix[x] + this->luminance[x];
+            for (unsigned int column = 0; column < width; column++) {
+                unsigned int left, right;
+                span(column, width, image.width, left, right);
+                this->sums[column] += this->prefix[right] - this->prefix[left];
+                if (y == top) this->counts[column] = (right - left) * (bottom - top);
+            }
+        }
+        std::fill(this->filled.begin(), this->filled.end(), 0);
+        for (unsigned int column = 0; column < width; column++) {
+            if (this->sums[column] < uint64_t(threshold) * this->counts[column])
+                this->filled[column / WORD_BITS] |= word(1) << (column % WORD_BITS);
+        }
+        for (unsigned int w = 0; w < this->filled.size(); w++) this->crossed[w] = ~this->filled[w] & lineMask(width, w);
+        picross.merge(ROWS, row, this->filled.data(), this->crossed.data());
+    }
+}
+
+void pc::PuzzleGenerator::gridToPuzzle(const Grid& picross, Puzzle& puzzle) {
+    puzzle.width = picross.getWidth();
+    puzzle.height = picross.getHeight();
+    for (unsigned char crs = 0; crs < 2; crs++) {
+        ClueList& clues = crs == ROWS ? puzzle.rows : puzzle.columns;
+        const unsigned int length = picross.lineLength(crs);
+        clues.clear();
+        for (unsigned int cr = 0; cr < picross.lineCount(crs); cr++) {
+            const word* bits = picross.filled(crs, cr);
+            clues.addLine();
+            for (unsigned int start = findBit(bits, length, 0, true); start < length;) {
+                const unsigned int end = findBit(bits, length, start, false);
+                clues.push(end - start);
+                start = findBit(bits, length, end, true);
+            }
+        }
+    }
+}
+
+static bool isBMPName(const std::string& name) {
+    if (name.size() < 4) return false;
+    std::string extension = name.substr(name.size() - 4);
+    for (char& c : extension) c = tolower(c);
+    return extension == ".bmp";
+}
+
+bool pc::listImages(const std::vector<std::string>& paths, std::vector<std::string>& files, std::string& error) {
+    for (const std::string& path : paths) {
+        struct stat info;
+        if (stat(path.c_str(), &info)) {
+            error = "could not open " + path;
+            return false;
+        }
+        if (!S_ISDIR(info.st_mode)) {
+            files.push_back(path);
+            continue;
+        }
+        DIR* directory = opendir(path.c_str());
+        if (!directory) {
+            error = "could not list " + path;
+            return false;
+        }
+        std::vector<std::string> names;
+        while (dirent* entry = readdir(directory)) {
+            if (isBMPName(entry->d_name)) names.push_back(path + "/" + entry->d_name);
+        }
+        closedir(directory);
+        std::sort(names.begin(), names.end());
+        files.insert(files.end(), names.begin(), names.end());
+    }
+    return true;
+}
+
+// Clue file for an image: its name without directory or extension, plus .non or .txt.
+static std::string outputName(const std::string& directory, const std::string& file, bool non) {
+    const size_t slash = file.find_last_of('/');
+    std::string name = file.substr(slash == std::string::npos ? 0 : slash + 1);
+    const size_t dot = name.find_last_of('.');
+    if (dot != std::string::npos && dot) name.resize(dot);
+    return directory + "/" + name + (non ? ".non" : ".txt");
+}
+
+pc::GenerateSummary pc::generatePuzzles(const std::vector<std::string>& files, std::ostream& out, const GenerateOptions& options) {
+    ThreadPool pool(options.threads);
+    SolveOptions solveOptions;
+    solveOptions.search = true;
+    solveOptions.solutionLimit = 2;
+
+    // Per-worker state, reused for every image that worker converts.
+    struct Workspace {
+        bm::BMPReader reader;
+        PuzzleGenerator generator;
+        Grid grid;
+        Puzzle puzzle;
+        Solver solver;
+        std::string result;
+    };
+    std::vector<Workspace> workspaces(pool.size());
+
+    std::mutex mutex;
+    std::condition_variable progress;
+    const size_t window = 64 * pool.size();
+    size_t written = 0;
+    // Results finished ahead of an earlier image, at their index modulo window.
+    std::vector<std::string> finished(window);
+    std::vector<uint8_t> waiting(window, 0);
+    GenerateSummary summary;
+
+    for (size_t index = 0; index < files.size(); index++) {
+        {
+            // Bound how many results can wait for an earlier slow image.
+            std::unique_lock<std::mutex> lock(mutex);
+            progress.wait(lock, [&]() { return index - written < window; });
+        }
+        pool.submit([&, index]() {
+            Workspace& workspace = workspaces[pool.currentWorker()];
+            const std::string& file = files[index];
+            workspace.result.clear();
+            bool failed = false, notUnique = false;
+            std::string error;
+
+            if (!workspace.reader.open(file.c_str())) {
+                failed = true;
+                error = workspace.reader.getError();
+            }
+            else {
+                const bm::Image& image = workspace.reader.getImage();
+                unsigned int width = options.width, height = options.height;
+                if (!width && !height) { width = image.width; height = image.height; }
+                else if (!width) width = std::max(1u, unsigned((uint64_t(image.width) * height + image.height / 2) / image.height));
+                else if (!height) height = std::max(1u, unsigned((uint64_t(image.height) * width + image.width / 2) / image.width));
+                if (width > CLUE_MAX || height > CLUE_MAX) {
+                    failed = true;
+                    error = "more than " + std::to_string(CLUE_MAX) + " cells a side";
+                }
+                else {
+                    workspace.generator.imageToGrid(image, width, height, options.threshold, workspace.grid);
+                    workspace.generator.gridToPuzzle(workspace.grid, workspace.puzzle);
+                }
+                workspace.reader.close();
+
+                if (!failed && options.unique) {
+                    SolveStats stats;
+                    workspace.grid.clear();
+                    workspace.solver.solve(workspace.grid, workspace.puzzle, solveOptions, &stats);
+                    notUnique = stats.solutions != 1;
+                }
+                if (!failed && !notUnique) {
+                    if (options.outputDirectory.empty()) workspace.result = "# " + file + "\n";
+                    if (options.non) appendNon(workspace.result, workspace.puzzle);
+                    else appendCompact(workspace.result, workspace.puzzle);
+                    if (!options.outputDirectory.empty()) {
+                        const std::string name = outputName(options.outputDirectory, file, options.non);
+                        std::ofstream clues(name, std::ofstream::binary);
+                        clues.write(workspace.result.data(), workspace.result.size());
+                        if (!clues.good()) {
+                            failed = true;
+                            error = "could not write " + name;
+                        }
+                        workspace.result.clear();
+                    }
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            summary.images++;
+            if (failed) {
+                summary.failed++;
+                std::cerr << file << ": " << error << std::endl;
+            }
+            else if (notUnique) summary.notUnique++;
+            else summary.written++;
+            if (index == written) {
+                out << workspace.result;
+                written++;
+                for (; waiting[written % window]; written++) {
+                    waiting[written % window] = 0;
+                    out << finished[written % window];
+                }
+                progress.notify_all();
+            }
+            else {
+                // Swapping hands the workspace the slot's old buffer, so neither reallocates.
+                finished[index % window].swap(workspace.result);
+                waiting[index % window] = 1;
+            }
+        });
+    }
+    pool.wait();
+    out.flush();
+    return summary;
+}
@@ -0,0 +1,69 @@
+/*
+ * Generator.h
+ * Namespace pc: Turns images into puzzles.
+ *
+ * A BMP is box-filtered down (or sampled up) to the target grid size, every
+ * cell darker than the threshold becomes a filled cell, and the clues are read
+ * off the rows and columns of the resulting packed grid. Optionally the puzzle
+ * is solved with search to check that the image is its only solution.
+ */
+#pragma once
+#include <ostream>
+#include <string>
+#include <vector>
+#include "Bitmap.h"
+#include "Solver.h"
+
+namespace pc {
+    struct GenerateOptions {
+        // Grid size; 0 keeps the image size, or its aspect ratio when only
+        // one of the two is given.
+        unsigned int width = 0, height = 0;
+        // A cell is filled when its average luminance (0-255) is below this.
+        unsigned int threshold = 128;
+        // Check every puzzle has exactly one solution and drop those that do not.
+        bool unique = false;
+        // Write .non blocks instead of compact lines.
+        bool non = false;
+        // Write one clue file per image into this directory instead of to the stream.
+        std::string outputDirectory;
+        unsigned int threads = 1;
+    };
+
+    struct GenerateSummary {
+        unsigned long long images = 0;
+        unsigned long long written = 0;
+        unsigned long long notUnique = 0;
+        unsigned long long failed = 0;
+    };
+
+    /*
+     * Image to grid to clues, keeping its scratch buffers between images so a
+     * generator reused for many images stops allocating once it has seen the
+     * largest.
+     */
+    class PuzzleGenerator {
+        public:
+            // Fills picross with the thresholded image, every cell known.
+            void imageToGrid(const bm::Image& image, unsigned int width, unsigned int height, unsigned int threshold,
+                             Grid& picross);
+            // Run-length encodes the filled cells of every row and column.
+            void gridToPuzzle(const Grid& picross, Puzzle& puzzle);
+
+        private:
+            std::vector<byte> luminance;
+            std::vector<uint64_t> prefix, sums, counts;
+            std::vector<word> filled, crossed;
+    };
+
+    // Expands directories into the .bmp files they hold, sorted by name.
+    bool listImages(const std::vector<std::string>& paths, std::vector<std::string>& files, std::string& error);
+
+    /*
+     * Generates a puzzle from every file, in parallel. Each puzzle is written
+     * to out in input order behind a "# <file>" comment line, so the stream
+     * can be fed straight back to solveBatch, or into its own clue file in
+     * options.outputDirectory. Unreadable images are reported on cerr.
+     */
+    GenerateSummary generatePuzzles(const std::vector<std::string>& files, std::ostream& out, const GenerateOptions& options);
+};
@@ -0,0 +1,193 @@
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "Grid.h"
+
+pc::Grid::~Grid() {
+    this->unmap();
+}
+
+void pc::Grid::unmap() {
+    if (this->mapping) munmap(this->mapping, this->size * sizeof(word));
+    this->mapping = nullptr;
+}
+
+void pc::Grid::resize(unsigned int width, unsigned int height) {
+    this->unmap();
+    this->width = width;
+    this->height = height;
+    this->rowWords = wordsFor(width);
+    this->columnWords = wordsFor(height);
+    this->size = 2 * (size_t(height) * this->rowWords + size_t(width) * this->columnWords);
+    this->owned.assign(this->size, 0);
+    this->bits = this->owned.data();
+    this->trail.clear();
+}
+
+bool pc::Grid::resizeMapped(unsigned int width, unsigned int height, const char* path) {
+    this->resize(0, 0);
+    const size_t size = 2 * (size_t(height) * wordsFor(width) + size_t(width) * wordsFor(height));
+    if (!size) {
+        this->resize(width, height);
+        return true;
+    }
+    const int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    // A freshly extended file reads as zeros: every cell unknown.
+    void* mapped = ftruncate(fd, size * sizeof(word)) ? MAP_FAILED
+                 : mmap(nullptr, size * sizeof(word), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) return false;
+    std::vector<word>().swap(this->owned);
+    this->width = width;
+    this->height = height;
+    this->rowWords = wordsFor(width);
+    this->columnWords = wordsFor(height);
+    this->size = size;
+    this->mapping = mapped;
+    this->bits = (word*)mapped;
+    return true;
+}
+
+void pc::Grid::clear() {
+    std::fill(this->bits, this->bits + this->size, 0);
+    this->trail.clear();
+}
+
+void pc::Grid::copyFrom(const Grid& other) {
+    if (!this->mapping || this->width != other.width || this->height != other.height) {
+        this->unmap();
+        this->owned.resize(other.size);
+        this->bits = this->owned.data();
+    }
+    this->width = other.width;
+    this->height = other.height;
+    this->rowWords = other.rowWords;
+    this->columnWords = other.columnWords;
+    this->size = other.size;
+    if (this->size) memcpy(this->bits, other.bits, this->size * sizeof(word));
+    this->trail.clear();
+}
+
+uint8_t pc::Grid::get(unsigned int row, unsigned int column) const {
+    const word bit = word(1) << (column % WORD_BITS);
+    if (this->filled(ROWS, row)[column / WORD_BITS] & bit) return FILLED;
+    if (this->crossed(ROWS, row)[column / WORD_BITS] & bit) return CROSSED;
+    return UNKNOWN;
+}
+
+void pc::Grid::set(unsigned int row, unsigned int column, uint8_t state) {
+    const word rowBit = word(1) << (column % WORD_BITS), columnBit = word(1) << (row % WORD_BITS);
+    word& rowFilled = this->line(ROWS, 0, row)[column / WORD_BITS];
+    word& rowCrossed = this->line(ROWS, 1, row)[column / WORD_BITS];
+    word& columnFilled = this->line(COLUMNS, 0, column)[row / WORD_BITS];
+    word& columnCrossed = this->line(COLUMNS, 1, column)[row / WORD_BITS];
+    this->save(rowFilled); this->save(rowCrossed);
+    this->save(columnFilled); this->save(columnCrossed);
+    rowFilled &= ~rowBit; rowCrossed &= ~rowBit;
+    columnFilled &= ~columnBit; columnCrossed &= ~columnBit;
+    if (state == FILLED) { rowFilled |= rowBit; columnFilled |= columnBit; }
+    else if (state == CROSSED) { rowCrossed |= rowBit; columnCrossed |= columnBit; }
+}
+
+unsigned int pc::Grid::merge(unsigned char crs, unsigned int cr, const word* filled, const word* crossed,
+                             word* changed) {
+    word scratch[16];
+    std::vector<word> large;
+    if (!changed) {
+        if (this->lineWords(crs) <= 16) changed = scratch;
+        else { large.resize(this->lineWords(crs)); changed = &large[0]; }
+    }
+    const unsigned int count = this->mergeLine(crs, cr, filled, crossed, changed);
+    if (count) this->syncCrossing(crs, cr, changed);
+    return count;
+}
+
+unsigned int pc::Grid::mergeLine(unsigned char crs, unsigned int cr, const word* filled, const word* crossed,
+                                 word* changed) {
+    const unsigned int words = this->lineWords(crs), length = this->lineLength(crs);
+    word* lineFilled = this->line(crs, 0, cr);
+    word* lineCrossed = this->line(crs, 1, cr);
+    unsigned int count = 0;
+    for (unsigned int w = 0; w < words; w++) {
+        const word unknown = ~(lineFilled[w] | lineCrossed[w]) & lineMask(length, w);
+        const word newFilled = filled[w] & unknown, newCrossed = crossed[w] & unknown & ~filled[w];
+        changed[w] = newFilled | newCrossed;
+        if (!changed[w]) continue;
+        this->save(lineFilled[w]); this->save(lineCrossed[w]);
+        lineFilled[w] |= newFilled;
+        lineCrossed[w] |= newCrossed;
+        count += __builtin_popcountll(changed[w]);
+    }
+    return count;
+}
+
+void pc::Grid::syncCrossing(unsigned char crs, unsigned int cr, const word* changed) {
+    const word* lineFilled = this->filled(crs, cr);
+    // The crossing lines hold this line's cells as bit cr of word cr / 64.
+    const unsigned char other = !crs;
+    const unsigned int otherWord = cr / WORD_BITS;
+    const word otherBit = word(1) << (cr % WORD_BITS);
+    for (unsigned int w = 0; w < this->lineWords(crs); w++) {
+        for (word m = changed[w]; m; m &= m - 1) {
+            const unsigned int b = __builtin_ctzll(m);
+            word& target = this->line(other, (lineFilled[w] >> b) & 1 ? 0 : 1, w * WORD_BITS + b)[otherWord];
+            this->save(target);
+            target |= otherBit;
+        }
+    }
+}
+
+void pc::Grid::forget(unsigned char crs, unsigned int cr, const word* cells) {
+    word* lineFilled = this->line(crs, 0, cr);
+    word* lineCrossed = this->line(crs, 1, cr);
+    const unsigned char other = !crs;
+    const unsigned int otherWord = cr / WORD_BITS;
+    const word otherBit = word(1) << (cr % WORD_BITS);
+    for (unsigned int w = 0; w < this->lineWords(crs); w++) {
+        if (!cells[w]) continue;
+        for (word m = cells[w]; m; m &= m - 1) {
+            const unsigned int b = __builtin_ctzll(m);
+            for (unsigned int plane = 0; plane < 2; plane++) {
+                word& target = this->line(other, plane, w * WORD_BITS + b)[otherWord];
+                this->save(target);
+                target &= ~otherBit;
+            }
+        }
+        this->save(lineFilled[w]); this->save(lineCrossed[w]);
+        lineFilled[w] &= ~cells[w];
+        lineCrossed[w] &= ~cells[w];
+    }
+}
+
+void pc::Grid::undo(size_t mark) {
+    // Replay newest first so a word logged twice ends at its oldest value.
+    while (this->trail.size() > mark) {
+        this->bits[this->trail.back().first] = this->trail.back().second;
+        this->trail.pop_back();
+    }
+}
+
+unsigned int pc::Grid::countFilled(unsigned char crs, unsigned int cr) const {
+    const word* f = this->filled(crs, cr);
+    unsigned int count = 0;
+    for (unsigned int w = 0; w < this->lineWords(crs); w++) count += __builtin_popcountll(f[w]);
+    return count;
+}
+
+unsigned int pc::Grid::countKnown(unsigned char crs, unsigned int cr) const {
+    const word* f = this->filled(crs, cr);
+    const word* c = this->crossed(crs, cr);
+    unsigned int count = 0;
+    for (unsigned int w = 0; w < this->lineWords(crs); w++) count += __builtin_popcountll(f[w] | c[w]);
+    return count;
+}
+
+bool pc::Grid::isSolved() const {
+    for (unsigned int row = 0; row < this->height; row++) {
+        if (!this->isLineComplete(ROWS, row)) return false;
+    }
+    return true;
+}
@@ -0,0 +1,190 @@
+/*
+ * Grid.h
+ * Namespace pc: Bit-packed picross grid.
+ *
+ * Every cell is one of three states (unknown, filled, crossed). Instead of one
+ * unsigned int per cell, the grid keeps two bitplanes ("filled" and "crossed")
+ * packed into 64-bit words. Each plane is stored twice: row-major, so a row is
+ * a run of consecutive words, and column-major, so a column is too. Row and
+ * column passes therefore both read memory in order, and whole-line operations
+ * (popcount, masking, merging deductions) run a word at a time.
+ *
+ * That is four bits per cell, with no per-row allocations or pointers. The
+ * bits live on the heap, or for grids larger than memory in a file mapping
+ * the kernel can page out (see resizeMapped).
+ */
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace pc {
+    typedef uint64_t word;
+
+    // Cell states, matching the 0/1/2 encoding the solver has always used.
+    const uint8_t UNKNOWN = 0;
+    const uint8_t FILLED  = 1;
+    const uint8_t CROSSED = 2;
+
+    // Line selector, matching the solver's crs convention.
+    const unsigned char COLUMNS = 0;
+    const unsigned char ROWS    = 1;
+
+    const unsigned int WORD_BITS = 64;
+
+    inline unsigned int wordsFor(unsigned int bits) { return (bits + WORD_BITS - 1) / WORD_BITS; }
+
+    // Mask of the valid bits in word w of a line that is length cells long.
+    inline word lineMask(unsigned int length, unsigned int w) {
+        const unsigned int remaining = length - w * WORD_BITS;
+        return remaining >= WORD_BITS ? ~word(0) : ((word(1) << remaining) - 1);
+    }
+
+    // Sets bits [from, to) of a multi-word bitset.
+    inline void setRange(word* bits, unsigned int from, unsigned int to) {
+        while (from < to) {
+            const unsigned int w = from / WORD_BITS, b = from % WORD_BITS;
+            const unsigned int n = (to - from < WORD_BITS - b) ? to - from : WORD_BITS - b;
+            bits[w] |= (n == WORD_BITS ? ~word(0) : ((word(1) << n) - 1)) << b;
+            from += n;
+        }
+    }
+
+    /*
+     * Index of the first bit at or after from that is set (or clear, when set
+     * is false) in a line of length bits, or length if there is none.
+     */
+    inline unsigned int findBit(const word* bits, unsigned int length, unsigned int from, bool set) {
+        const unsigned int words = wordsFor(length);
+        for (unsigned int w = from / WORD_BITS; w < words; w++) {
+            word value = set ? bits[w] : ~bits[w];
+            if (w == from / WORD_BITS) value &= ~word(0) << (from % WORD_BITS);
+            if (value) {
+                const unsigned int bit = w * WORD_BITS + __builtin_ctzll(value);
+                return bit < length ? bit : length;
+            }
+        }
+        return length;
+    }
+
+    class Grid {
+        public:
+            Grid() : width(0), height(0), rowWords(0), columnWords(0), bits(nullptr), size(0), mapping(nullptr),
+                     trailing(false) {}
+            Grid(unsigned int width, unsigned int height) : Grid() { this->resize(width, height); }
+            Grid(const Grid& other) : Grid() { this->copyFrom(other); }
+            Grid& operator=(const Grid& other) {
+                if (this != &other) this->copyFrom(other);
+                return *this;
+            }
+            ~Grid();
+
+            // Changes the dimensions and clears every cell back to unknown, keeping the cells on the heap.
+            void resize(unsigned int width, unsigned int height);
+            /*
+             * Like resize(), but keeps the cells in the file at path, created
+             * or truncated to fit and mapped shared, so the kernel can write
+             * cells out to it under memory pressure and the grid can be larger
+             * than memory. False if the file cannot be created or mapped. The
+             * file stays behind; the next resize() goes back to the heap.
+             */
+            bool resizeMapped(unsigned int width, unsigned int height, const char* path);
+            inline bool isMapped() const { return this->mapping; }
+            // Clears every cell back to unknown.
+            void clear();
+            /*
+             * Copies the dimensions and cells of other, but not its trail. A
+             * mapped grid stays mapped if the dimensions match.
+             */
+            void copyFrom(const Grid& other);
+
+            inline unsigned int getWidth() const { return this->width; }
+            inline unsigned int getHeight() const { return this->height; }
+
+            // Number of lines / cells per line / words per line for crs.
+            inline unsigned int lineCount(unsigned char crs) const { return crs ? this->height : this->width; }
+            inline unsigned int lineLength(unsigned char crs) const { return crs ? this->width : this->height; }
+            inline unsigned int lineWords(unsigned char crs) const { return crs ? this->rowWords : this->columnWords; }
+
+            // Word views of one line. Bit i of the line is cell i along it.
+            inline const word* filled(unsigned char crs, unsigned int cr) const {
+                return &this->bits[this->planeOffset(crs, 0) + cr * this->lineWords(crs)];
+            }
+            inline const word* crossed(unsigned char crs, unsigned int cr) const {
+                return &this->bits[this->planeOffset(crs, 1) + cr * this->lineWords(crs)];
+            }
+
+            uint8_t get(unsigned int row, unsigned int column) const;
+            void set(unsigned int row, unsigned int column, uint8_t state);
+
+            /*
+             * Adds deductions to one line: every bit set in filled/crossed
+             * becomes known in both orientations. Returns the number of cells
+             * that changed from unknown. Cells already known are left alone. If
+             * changed is given, it receives a mask of the cells that changed.
+             */
+            unsigned int merge(unsigned char crs, unsigned int cr, const word* filled, const word* crossed,
+                               word* changed = nullptr);
+
+            /*
+             * The two halves of merge(), for parallel sweeps. mergeLine() only
+             * writes the words of line cr itself, so different lines of one
+             * orientation can be merged concurrently. syncCrossing() then copies
+             * the changed cells into the crossing lines; it writes word cr / 64
+             * of those lines, so it is safe to run concurrently for lines in
+             * different blocks of 64.
+             */
+            unsigned int mergeLine(unsigned char crs, unsigned int cr, const word* filled, const word* crossed,
+                                   word* changed);
+            void syncCrossing(unsigned char crs, unsigned int cr, const word* changed);
+
+            // Turns the cells of line cr set in cells back to unknown, in both orientations.
+            void forget(unsigned char crs, unsigned int cr, const word* cells);
+
+            unsigned int countFilled(unsigned char crs, unsigned int cr) const;
+            unsigned int countKnown(unsigned char crs, unsigned int cr) const;
+            inline bool isLineComplete(unsigned char crs, unsigned int cr) const {
+                return this->countKnown(crs, cr) == this->lineLength(crs);
+            }
+            bool isSolved() const;
+
+            /*
+             * Undo log for search. While trailing, every word that set() or
+             * merge() overwrites is logged first, so undo(mark) can roll the
+             * grid back to the point where trailSize() returned mark at a cost
+             * proportional to the cells changed since then.
+             */
+            inline void setTrailing(bool trailing) { this->trailing = trailing; this->trail.clear(); }
+            inline size_t trailSize() const { return this->trail.size(); }
+            void undo(size_t mark);
+
+            // Bytes of cell storage held by this grid.
+            inline size_t memoryUsage() const { return this->size * sizeof(word); }
+
+        private:
+            // Layout of bits: row filled | row crossed | column filled | column crossed.
+            inline size_t planeOffset(unsigned char crs, unsigned int plane) const {
+                const size_t rowPlane = size_t(this->height) * this->rowWords;
+                const size_t columnPlane = size_t(this->width) * this->columnWords;
+                return crs ? plane * rowPlane : 2 * rowPlane + plane * columnPlane;
+            }
+            inline word* line(unsigned char crs, unsigned int plane, unsigned int cr) {
+                return &this->bits[this->planeOffset(crs, plane) + cr * this->lineWords(crs)];
+            }
+            inline void save(const word& w) {
+                if (this->trailing) this->trail.push_back(std::make_pair(size_t(&w - this->bits), w));
+            }
+            void unmap();
+
+            unsigned int width, height;
+            unsigned int rowWords, columnWords;
+            // The cells: owned's storage, or mapping.
+            std::vector<word> owned;
+            word* bits;
+            size_t size;
+            void* mapping;
+            bool trailing;
+            std::vector<std::pair<size_t, word>> trail;
+    };
+};
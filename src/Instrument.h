@@ -0,0 +1,51 @@
+/*
+ * Instrument.h
+ * Namespace pc: Compile-time switch for solver instrumentation.
+ *
+ * Built with PICROSS_INSTRUMENT defined (make INSTRUMENT=1), the solver also
+ * counts propagation rounds and times every phase of a solve into the
+ * SolveStats it is given. Otherwise PC_COUNT and PC_PHASE expand to nothing,
+ * so the hot paths compile exactly as if they were not there.
+ */
+#pragma once
+#include <chrono>
+
+namespace pc {
+#ifdef PICROSS_INSTRUMENT
+    const bool instrumented = true;
+#else
+    const bool instrumented = false;
+#endif
+
+    // Adds the nanoseconds between its construction and destruction to *total.
+    class PhaseTimer {
+        public:
+            explicit PhaseTimer(unsigned long long* total)
+                : total(total), start(std::chrono::steady_clock::now()) {}
+            ~PhaseTimer() {
+                if (this->total) {
+                    *this->total += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - this->start).count();
+                }
+            }
+            PhaseTimer(const PhaseTimer&) = delete;
+            PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+        private:
+            unsigned long long* total;
+            std::chrono::steady_clock::time_point start;
+    };
+};
+
+#define PC_JOIN2(a, b) a##b
+#define PC_JOIN(a, b) PC_JOIN2(a, b)
+
+#ifdef PICROSS_INSTRUMENT
+// stats->field += amount, when stats is not null.
+#define PC_COUNT(stats, field, amount) do { if (stats) (stats)->field += (amount); } while (0)
+// Times the rest of the enclosing scope into stats->field, when stats is not null.
+#define PC_PHASE(stats, field) pc::PhaseTimer PC_JOIN(phaseTimer, __LINE__)((stats) ? &(stats)->field : nullptr)
+#else
+#define PC_COUNT(stats, field, amount) do {} while (0)
+#define PC_PHASE(stats, field) do {} while (0)
+#endif
@@ -0,0 +1,133 @@
+#include <cstring>
+#include <new>
+#include <sys/mman.h>
+#include "LineCache.h"
+
+namespace {
+    const size_t SHARDS = 64;
+
+    inline uint64_t mix(uint64_t x) {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ull;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebull;
+        return x ^ (x >> 31);
+    }
+}
+
+pc::LineCache::LineCache(size_t bytes) : shards(new Shard[SHARDS]), shardCount(SHARDS) {
+    // Largest power of two of two-entry sets that fits the cap in every shard.
+    const size_t perShard = bytes / SHARDS / (2 * sizeof(Entry));
+    this->sets = 1;
+    while (this->sets * 2 <= perShard) this->sets *= 2;
+
+    // Fresh anonymous pages read as zero, and an all-zero entry is empty and
+    // never matches: hash() keeps the top bit of every key set. Random probes
+    // over a large table would miss the TLB on almost every lookup with
+    // small pages.
+    this->tableBytes = SHARDS * this->sets * 2 * sizeof(Entry);
+    this->table = mmap(nullptr, this->tableBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (this->table == MAP_FAILED) {
+        this->table = nullptr;
+        this->sets = 0;
+    }
+    else madvise(this->table, this->tableBytes, MADV_HUGEPAGE);
+    Entry* entries = this->table ? new (this->table) Entry[SHARDS * this->sets * 2] : nullptr;
+    for (size_t s = 0; s < SHARDS; s++) {
+        Shard& shard = this->shards[s];
+        shard.entries = entries + s * this->sets * 2;
+        shard.inserts.store(0, std::memory_order_relaxed);
+        shard.evictions.store(0, std::memory_order_relaxed);
+    }
+}
+
+pc::LineCache::~LineCache() {
+    if (this->table) munmap(this->table, this->tableBytes);
+}
+
+uint64_t pc::LineCache::hash(const LineJob& job) {
+    uint64_t words[LINE_KERNEL_BLOCKS / 8];
+    memcpy(words, job.block, sizeof(words));
+    uint64_t h = mix(job.filled ^ (uint64_t(job.length) << 56 | job.blocks));
+    h = mix(h ^ job.crossed);
+    // setLineJob zeroes the unused blocks, so whole words can be hashed.
+    for (unsigned int w = 0; w * 8 < job.blocks; w++) h = mix(h ^ words[w]);
+    return h | uint64_t(1) << 63;
+}
+
+bool pc::LineCache::makeKey(const LineJob& job, uint64_t hash, uint64_t* key) {
+    if (job.blocks > LINE_CACHE_BLOCKS) return false;
+    // Blocks are 1 to 64 cells long, stored less one; ten to a word.
+    uint64_t packed[2] = {0, 0};
+    for (unsigned int b = 0; b < job.blocks; b++) packed[b / 10] |= uint64_t(job.block[b] - 1) << (b % 10 * 6);
+    key[0] = job.length | job.blocks << 7 | (hash & ~uint64_t(0xfff));
+    key[1] = job.filled;
+    key[2] = job.crossed;
+    key[3] = packed[0];
+    key[4] = packed[1];
+    return true;
+}
+
+bool pc::LineCache::lookup(LineJob& job, uint64_t hash) const {
+    uint64_t key[KEY_WORDS];
+    if (!this->sets || !makeKey(job, hash, key)) return false;
+    const Shard& shard = this->shards[hash % SHARDS];
+    const size_t set = (hash / SHARDS) & (this->sets - 1);
+    for (size_t way = 0; way < 2; way++) {
+        const Entry& entry = shard.entries[set * 2 + way];
+        const uint64_t before = entry.sequence.load(std::memory_order_acquire);
+        if (before & 1) continue;
+        bool match = true;
+        for (unsigned int w = 0; w < KEY_WORDS && match; w++) match = entry.key[w].load(std::memory_order_relaxed) == key[w];
+        if (!match) continue;
+        const uint64_t filled = entry.value[0].load(std::memory_order_relaxed);
+        const uint64_t crossed = entry.value[1].load(std::memory_order_relaxed);
+        // Only valid if no store started or finished while we were reading.
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (entry.sequence.load(std::memory_order_relaxed) != before) continue;
+        // A solvable line never has a cell both filled and crossed.
+        job.solvable = !(filled & crossed);
+        job.outFilled = filled;
+        job.outCrossed = crossed;
+        return true;
+    }
+    return false;
+}
+
+void pc::LineCache::store(const LineJob& job, uint64_t hash) {
+    uint64_t key[KEY_WORDS];
+    if (!this->sets || !job.feasible || !makeKey(job, hash, key)) return;
+    Shard& shard = this->shards[hash % SHARDS];
+    const size_t set = (hash / SHARDS) & (this->sets - 1);
+    // Fill the first empty way; once both are taken, the hash picks the victim.
+    Entry* entry = &shard.entries[set * 2];
+    bool evicting = false;
+    if (entry[0].key[0].load(std::memory_order_relaxed)) {
+        if (!entry[1].key[0].load(std::memory_order_relaxed)) entry++;
+        else {
+            entry += (hash >> 62) & 1;
+            evicting = true;
+        }
+    }
+    uint64_t sequence = entry->sequence.load(std::memory_order_relaxed);
+    // Another thread is writing this entry; let it win.
+    if ((sequence & 1) || !entry->sequence.compare_exchange_strong(sequence, sequence + 1, std::memory_order_relaxed)) {
+        return;
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    for (unsigned int w = 0; w < KEY_WORDS; w++) entry->key[w].store(key[w], std::memory_order_relaxed);
+    entry->value[0].store(job.solvable ? job.outFilled : ~uint64_t(0), std::memory_order_relaxed);
+    entry->value[1].store(job.solvable ? job.outCrossed : ~uint64_t(0), std::memory_order_relaxed);
+    entry->sequence.store(sequence + 2, std::memory_order_release);
+    shard.inserts.fetch_add(1, std::memory_order_relaxed);
+    if (evicting) shard.evictions.fetch_add(1, std::memory_order_relaxed);
+}
+
+pc::LineCacheCounters pc::LineCache::getCounters() const {
+    LineCacheCounters total;
+    for (size_t s = 0; s < this->shardCount; s++) {
+        total.inserts += this->shards[s].inserts.load(std::memory_order_relaxed);
+        total.evictions += this->shards[s].evictions.load(std::memory_order_relaxed);
+    }
+    return total;
+}
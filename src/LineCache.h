@@ -0,0 +1,87 @@
+/*
+ * LineCache.h
+ * Namespace pc: Bounded memo of line solves, shared between threads.
+ *
+ * The same clues and partial line come back again and again: in later
+ * propagation rounds, in sibling search branches and in other puzzles of a
+ * batch. The cache maps a line job (its length, blocks and known cells) to
+ * what the line kernel deduced from it. Only lines of up to
+ * LINE_KERNEL_LENGTH cells are cached.
+ *
+ * The table is a fixed number of shards of two-way sets, sized once from a
+ * memory cap; a full set evicts one of its two entries and nothing is
+ * allocated after construction. It is one anonymous mapping, backed by huge
+ * pages where the kernel allows, whose pages are only touched once used. An
+ * entry fills one 64-byte cache line, so lines with more than
+ * LINE_CACHE_BLOCKS blocks are not cached.
+ *
+ * Entries are guarded by sequence counters instead of locks: a lookup is a
+ * handful of loads and never waits, and a store that finds its entry busy is
+ * simply dropped. Keys are compared in full, so a hash collision costs a
+ * miss, never a wrong answer.
+ *
+ * Lookups and hits are counted by the caller, in SolveStats; the cache only
+ * counts its own inserts and evictions.
+ */
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include "LineKernel.h"
+
+namespace pc {
+    const unsigned int LINE_CACHE_BLOCKS = 20; // Most blocks of a cached line.
+
+    struct LineCacheCounters {
+        unsigned long long inserts = 0;
+        unsigned long long evictions = 0;
+    };
+
+    class LineCache {
+        public:
+            // Uses at most about bytes of memory, with at least one set per shard.
+            explicit LineCache(size_t bytes);
+            ~LineCache();
+            LineCache(const LineCache&) = delete;
+            LineCache& operator=(const LineCache&) = delete;
+
+            // Key hash of a job filled in by setLineJob.
+            static uint64_t hash(const LineJob& job);
+            // Copies a cached result into job's output half; false on a miss.
+            bool lookup(LineJob& job, uint64_t hash) const;
+            // Remembers a solved job. Infeasible jobs are not worth a slot.
+            void store(const LineJob& job, uint64_t hash);
+
+            // Sums over all shards.
+            LineCacheCounters getCounters() const;
+            inline size_t capacity() const { return this->shardCount * this->sets * 2; }
+
+        private:
+            static const unsigned int KEY_WORDS = 5;
+
+            /*
+             * sequence is odd while a store is writing. key holds length,
+             * blocks and hash bits, filled, crossed and the blocks six bits
+             * each; value holds outFilled and outCrossed, both all ones for a
+             * line with no solution.
+             */
+            struct alignas(64) Entry {
+                std::atomic<uint64_t> sequence;
+                std::atomic<uint64_t> key[KEY_WORDS];
+                std::atomic<uint64_t> value[2];
+            };
+            struct alignas(64) Shard {
+                Entry* entries;
+                std::atomic<unsigned long long> inserts, evictions;
+            };
+
+            // False if the job has too many blocks to be cached.
+            static bool makeKey(const LineJob& job, uint64_t hash, uint64_t* key);
+
+            std::unique_ptr<Shard[]> shards;
+            size_t shardCount, sets;
+            // Every shard's entries, in one anonymous mapping.
+            void* table;
+            size_t tableBytes;
+    };
+};
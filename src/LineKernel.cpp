@@ -0,0 +1,86 @@
+#include <cstdlib>
+#include <cstring>
+#include "LineKernelImpl.h"
+
+namespace {
+    // One lane: a plain word. Shifts of 64 or more are 0, as with AVX2.
+    struct ScalarVec {
+        static const unsigned int LANES = 1;
+        uint64_t v;
+
+        static inline ScalarVec splat(uint64_t x) { return {x}; }
+        static inline ScalarVec load(const uint64_t* p) { return {*p}; }
+        inline void store(uint64_t* p) const { *p = this->v; }
+    };
+    inline ScalarVec operator&(ScalarVec a, ScalarVec b) { return {a.v & b.v}; }
+    inline ScalarVec operator|(ScalarVec a, ScalarVec b) { return {a.v | b.v}; }
+    inline ScalarVec operator^(ScalarVec a, ScalarVec b) { return {a.v ^ b.v}; }
+    inline ScalarVec operator+(ScalarVec a, ScalarVec b) { return {a.v + b.v}; }
+    inline ScalarVec operator-(ScalarVec a, ScalarVec b) { return {a.v - b.v}; }
+    inline ScalarVec andNot(ScalarVec a, ScalarVec b) { return {a.v & ~b.v}; }
+    inline ScalarVec shl(ScalarVec a, ScalarVec count) { return {count.v < 64 ? a.v << count.v : 0}; }
+    inline ScalarVec shr(ScalarVec a, ScalarVec count) { return {count.v < 64 ? a.v >> count.v : 0}; }
+    inline ScalarVec min(ScalarVec a, ScalarVec b) { return {a.v < b.v ? a.v : b.v}; }
+    inline ScalarVec bitReverse(ScalarVec a) {
+        uint64_t x = __builtin_bswap64(a.v);
+        x = ((x >> 4) & 0x0f0f0f0f0f0f0f0full) | ((x & 0x0f0f0f0f0f0f0f0full) << 4);
+        x = ((x >> 2) & 0x3333333333333333ull) | ((x & 0x3333333333333333ull) << 2);
+        x = ((x >> 1) & 0x5555555555555555ull) | ((x & 0x5555555555555555ull) << 1);
+        return {x};
+    }
+
+    struct Kernel {
+        void (*solve)(pc::LineJob*, unsigned int);
+        unsigned int lanes;
+        const char* name;
+    };
+
+    Kernel pickKernel() {
+        const char* forced = getenv("PICROSS_LINE_KERNEL");
+        const bool scalar = forced && !strcmp(forced, "scalar");
+        __builtin_cpu_init();
+        if (!scalar && __builtin_cpu_supports("avx2")) return {pc::solveLineJobsAvx2, 4, "avx2"};
+        return {solveJobs<ScalarVec>, 1, "scalar"};
+    }
+
+    const Kernel& kernel() {
+        static const Kernel picked = pickKernel();
+        return picked;
+    }
+}
+
+bool pc::setLineJob(LineJob& job, const uint16_t* clues, unsigned int count, unsigned int length,
+                    uint64_t filled, uint64_t crossed) {
+    if (length > LINE_KERNEL_LENGTH) return false;
+    job.filled = filled;
+    job.crossed = crossed;
+    job.length = length;
+    job.blocks = 0;
+    job.feasible = true;
+    memset(job.block, 0, sizeof(job.block));
+    unsigned int used = 0;
+    for (unsigned int i = 0; i < count; i++) {
+        if (!clues[i]) continue;
+        used += clues[i] + (job.blocks ? 1 : 0);
+        // Too many cells for the line; no need to look at the rest.
+        if (used > length) {
+            job.feasible = false;
+            job.blocks = 0;
+            break;
+        }
+        job.block[job.blocks++] = clues[i];
+    }
+    return true;
+}
+
+void pc::solveLineJobs(LineJob* jobs, unsigned int count) {
+    if (count) kernel().solve(jobs, count);
+}
+
+unsigned int pc::lineKernelLanes() {
+    return kernel().lanes;
+}
+
+const char* pc::lineKernelName() {
+    return kernel().name;
+}
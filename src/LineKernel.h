@@ -0,0 +1,54 @@
+/*
+ * LineKernel.h
+ * Namespace pc: Bit-parallel solver for lines of up to 64 cells, several
+ * lines at a time.
+ *
+ * A line that fits in one word is solved with shifts, masks and adds over
+ * whole words instead of the cell-by-cell dynamic program of LineSolver. For
+ * every block the kernel keeps the set of start cells that the blocks before
+ * it allow (a forward pass) and the set the blocks after it allow (the same
+ * pass over the bit-reversed line); a start in both belongs to some complete
+ * placement. Moving past cells that may stay empty is a single add, whose
+ * carry runs through the non-filled cells. The result is the same as
+ * LineSolver::deduce.
+ *
+ * On CPUs with AVX2 four lines go through each pass, one per 64-bit lane,
+ * using per-lane variable shifts; elsewhere a scalar build of the same kernel
+ * runs one line per pass. The choice is made once at run time, and setting
+ * PICROSS_LINE_KERNEL=scalar in the environment forces the scalar build.
+ */
+#pragma once
+#include <cstdint>
+
+namespace pc {
+    const unsigned int LINE_KERNEL_LENGTH = 64; // Longest line the kernel takes.
+    const unsigned int LINE_KERNEL_BLOCKS = 32; // Most blocks a solvable line that long can have.
+    const unsigned int LINE_KERNEL_LANES_MAX = 4; // Most lines any kernel solves per pass.
+
+    struct LineJob {
+        // Input: the line's length, its known cells and its blocks.
+        uint64_t filled, crossed;
+        unsigned int length, blocks;
+        uint8_t block[LINE_KERNEL_BLOCKS]; // Zero past the last block.
+        // False when the clues cannot fit the length at all.
+        bool feasible;
+
+        // Output: every cell known after deduction, as LineSolver::deduce.
+        uint64_t outFilled, outCrossed;
+        bool solvable;
+    };
+
+    /*
+     * Fills in the input half of job. Zero-valued clues are ignored. False if
+     * the line is longer than LINE_KERNEL_LENGTH and needs LineSolver.
+     */
+    bool setLineJob(LineJob& job, const uint16_t* clues, unsigned int count, unsigned int length,
+                    uint64_t filled, uint64_t crossed);
+
+    // Solves count jobs, as many per pass as the instruction set allows.
+    void solveLineJobs(LineJob* jobs, unsigned int count);
+
+    // Lines per pass of the kernel picked at run time, and its name.
+    unsigned int lineKernelLanes();
+    const char* lineKernelName();
+};
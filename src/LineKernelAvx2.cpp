@@ -0,0 +1,41 @@
+// Built with -mavx2; only called once the CPU is known to have AVX2.
+#include <immintrin.h>
+#include "LineKernelImpl.h"
+
+namespace {
+    // Four lanes in one 256-bit register.
+    struct Avx2Vec {
+        static const unsigned int LANES = 4;
+        __m256i v;
+
+        static inline Avx2Vec splat(uint64_t x) { return {_mm256_set1_epi64x(x)}; }
+        static inline Avx2Vec load(const uint64_t* p) { return {_mm256_loadu_si256((const __m256i*)p)}; }
+        inline void store(uint64_t* p) const { _mm256_storeu_si256((__m256i*)p, this->v); }
+    };
+    inline Avx2Vec operator&(Avx2Vec a, Avx2Vec b) { return {_mm256_and_si256(a.v, b.v)}; }
+    inline Avx2Vec operator|(Avx2Vec a, Avx2Vec b) { return {_mm256_or_si256(a.v, b.v)}; }
+    inline Avx2Vec operator^(Avx2Vec a, Avx2Vec b) { return {_mm256_xor_si256(a.v, b.v)}; }
+    inline Avx2Vec operator+(Avx2Vec a, Avx2Vec b) { return {_mm256_add_epi64(a.v, b.v)}; }
+    inline Avx2Vec operator-(Avx2Vec a, Avx2Vec b) { return {_mm256_sub_epi64(a.v, b.v)}; }
+    inline Avx2Vec andNot(Avx2Vec a, Avx2Vec b) { return {_mm256_andnot_si256(b.v, a.v)}; }
+    // Variable shifts already give 0 for counts of 64 or more.
+    inline Avx2Vec shl(Avx2Vec a, Avx2Vec count) { return {_mm256_sllv_epi64(a.v, count.v)}; }
+    inline Avx2Vec shr(Avx2Vec a, Avx2Vec count) { return {_mm256_srlv_epi64(a.v, count.v)}; }
+    // Counts fit in the low 32 bits of each lane, where the high halves are 0.
+    inline Avx2Vec min(Avx2Vec a, Avx2Vec b) { return {_mm256_min_epu32(a.v, b.v)}; }
+    inline Avx2Vec bitReverse(Avx2Vec a) {
+        const __m256i bytes = _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+                                               7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+        const __m256i nibbles = _mm256_setr_epi8(0, 8, 4, 12, 2, 10, 6, 14, 1, 9, 5, 13, 3, 11, 7, 15,
+                                                 0, 8, 4, 12, 2, 10, 6, 14, 1, 9, 5, 13, 3, 11, 7, 15);
+        const __m256i low = _mm256_set1_epi8(0x0f);
+        const __m256i x = _mm256_shuffle_epi8(a.v, bytes);
+        const __m256i high = _mm256_shuffle_epi8(nibbles, _mm256_and_si256(_mm256_srli_epi16(x, 4), low));
+        const __m256i swapped = _mm256_shuffle_epi8(nibbles, _mm256_and_si256(x, low));
+        return {_mm256_or_si256(_mm256_slli_epi16(swapped, 4), high)};
+    }
+}
+
+void pc::solveLineJobsAvx2(LineJob* jobs, unsigned int count) {
+    solveJobs<Avx2Vec>(jobs, count);
+}
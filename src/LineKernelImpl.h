@@ -0,0 +1,172 @@
+/*
+ * LineKernelImpl.h
+ * Namespace pc: The kernel behind LineKernel.h, written once over a vector
+ * type and compiled twice: in LineKernel.cpp with a one-lane scalar type and
+ * in LineKernelAvx2.cpp, built with -mavx2, with a four-lane type. Only those
+ * two files include it. Everything here has internal linkage so that no
+ * AVX2-compiled copy of a function can stand in for the scalar one.
+ *
+ * The vector type V holds V::LANES 64-bit lanes and provides & | ^ +,
+ * andNot(a, b) = a & ~b, per-lane shl/shr that give 0 for counts of 64 or
+ * more, per-lane min of small counts, bit reversal, V::splat, V::load and
+ * store.
+ */
+#pragma once
+#include <cstdint>
+#include "LineKernel.h"
+
+namespace pc {
+    // Four jobs per pass; defined in LineKernelAvx2.cpp.
+    void solveLineJobsAvx2(LineJob* jobs, unsigned int count);
+};
+
+namespace {
+    // Cells reachable from a seed in G by stepping right over cells in P:
+    // R[i] = G[i] | (R[i - 1] & P[i - 1]). The add carries through runs of P.
+    template <class V>
+    inline V smear(const V& g, const V& p) {
+        return g | ((p + (g & p)) ^ p);
+    }
+
+    // Bits s with every bit of [s, s + b) set in x, by doubling the run length.
+    template <class V>
+    inline V runs(V x, const V& b) {
+        V length = V::splat(1);
+        for (int step = 0; step < 6; step++) {
+            const V shift = min(length, b - length);
+            x = x & shr(x, shift);
+            length = length + shift;
+        }
+        return x;
+    }
+
+    // Every bit of x widened into the b bits starting at it.
+    template <class V>
+    inline V spread(V x, const V& b) {
+        V length = V::splat(1);
+        for (int step = 0; step < 6; step++) {
+            const V shift = min(length, b - length);
+            x = x | shl(x, shift);
+            length = length + shift;
+        }
+        return x;
+    }
+
+    template <class V>
+    struct KernelLanes {
+        uint64_t mask[V::LANES], reverse[V::LANES];
+        // Block lengths by index, in order and reversed; 1 past the end.
+        uint64_t forward[pc::LINE_KERNEL_BLOCKS][V::LANES], backward[pc::LINE_KERNEL_BLOCKS][V::LANES];
+        // starts[j]: where block j can start; after[j]: cells that can stay
+        // empty once j blocks are placed.
+        uint64_t starts[pc::LINE_KERNEL_BLOCKS][V::LANES], after[pc::LINE_KERNEL_BLOCKS + 1][V::LANES];
+        uint64_t startsBack[pc::LINE_KERNEL_BLOCKS][V::LANES], afterBack[pc::LINE_KERNEL_BLOCKS + 1][V::LANES];
+        // The backward results reindexed to match the forward ones.
+        uint64_t startsRight[pc::LINE_KERNEL_BLOCKS][V::LANES], afterRight[pc::LINE_KERNEL_BLOCKS + 1][V::LANES];
+    };
+
+    /*
+     * One direction: places blocks[0..] from the left end, recording for each
+     * block the starts the blocks before it allow, and the empty cells that
+     * can follow it.
+     */
+    template <class V>
+    void sweep(const V& filled, const V& crossed, const V& mask, unsigned int maxBlocks,
+               const uint64_t (*blocks)[V::LANES], uint64_t (*starts)[V::LANES], uint64_t (*after)[V::LANES]) {
+        const V open = andNot(mask, filled), free = andNot(mask, crossed);
+        V reach = smear(V::splat(1), open);
+        reach.store(after[0]);
+        V candidates = reach;
+        for (unsigned int j = 0; j < maxBlocks; j++) {
+            const V b = V::load(blocks[j]);
+            // Block j fits at s: no cross inside, no filled cell either side.
+            const V fits = andNot(andNot(runs(free, b), shr(filled, b)), shl(filled, V::splat(1)));
+            const V start = fits & candidates;
+            reach = smear(shl(start, b), open);
+            candidates = shl(reach & open, V::splat(1));
+            start.store(starts[j]);
+            reach.store(after[j + 1]);
+        }
+    }
+
+    // Solves exactly V::LANES jobs; pass the same job more than once to pad.
+    template <class V>
+    void solveLanes(pc::LineJob* const* jobs) {
+        KernelLanes<V> lanes;
+        uint64_t filled[V::LANES], crossed[V::LANES], filledBack[V::LANES], crossedBack[V::LANES];
+        unsigned int maxBlocks = 0;
+        for (unsigned int lane = 0; lane < V::LANES; lane++) {
+            const pc::LineJob& job = *jobs[lane];
+            lanes.mask[lane] = job.length >= 64 ? ~uint64_t(0) : (uint64_t(1) << job.length) - 1;
+            lanes.reverse[lane] = 64 - job.length;
+            filled[lane] = job.filled;
+            crossed[lane] = job.crossed;
+            if (job.blocks > maxBlocks) maxBlocks = job.blocks;
+        }
+        for (unsigned int j = 0; j < maxBlocks; j++) {
+            for (unsigned int lane = 0; lane < V::LANES; lane++) {
+                const pc::LineJob& job = *jobs[lane];
+                lanes.forward[j][lane] = j < job.blocks ? job.block[j] : 1;
+                lanes.backward[j][lane] = j < job.blocks ? job.block[job.blocks - 1 - j] : 1;
+            }
+        }
+
+        // Bit i of a reversed line is cell length - 1 - i.
+        const V reverse = V::load(lanes.reverse), mask = V::load(lanes.mask);
+        auto flip = [&](const V& x) { return shr(bitReverse(x), reverse); };
+        const V f = V::load(filled), x = V::load(crossed);
+        flip(f).store(filledBack);
+        flip(x).store(crossedBack);
+
+        sweep(f, x, mask, maxBlocks, lanes.forward, lanes.starts, lanes.after);
+        sweep(V::load(filledBack), V::load(crossedBack), mask, maxBlocks, lanes.backward, lanes.startsBack, lanes.afterBack);
+
+        // Line the backward results up with the forward ones: block j is
+        // block blocks - 1 - j from the right, and j blocks on the left leave
+        // blocks - j on the right. Past a lane's last block they are empty.
+        for (unsigned int j = 0; j <= maxBlocks; j++) {
+            for (unsigned int lane = 0; lane < V::LANES; lane++) {
+                const unsigned int blocks = jobs[lane]->blocks;
+                if (j < maxBlocks) lanes.startsRight[j][lane] = j < blocks ? lanes.startsBack[blocks - 1 - j][lane] : 0;
+                lanes.afterRight[j][lane] = j <= blocks ? lanes.afterBack[blocks - j][lane] : 0;
+            }
+        }
+
+        V canCross = V::splat(0), canFill = V::splat(0), firstStarts = V::splat(0);
+        for (unsigned int j = 0; j <= maxBlocks; j++) {
+            canCross = canCross | (V::load(lanes.after[j]) & flip(V::load(lanes.afterRight[j])));
+            if (j == maxBlocks) break;
+            const V b = V::load(lanes.forward[j]);
+            // A backward start marks the block's last cell in forward order.
+            const V start = V::load(lanes.starts[j]) & shr(flip(V::load(lanes.startsRight[j])), b - V::splat(1));
+            canFill = canFill | spread(start, b);
+            if (!j) firstStarts = start;
+        }
+        canCross = andNot(canCross, f) & mask;
+
+        uint64_t cross[V::LANES], fill[V::LANES], first[V::LANES];
+        canCross.store(cross);
+        canFill.store(fill);
+        firstStarts.store(first);
+        for (unsigned int lane = 0; lane < V::LANES; lane++) {
+            pc::LineJob& job = *jobs[lane];
+            const uint64_t laneMask = lanes.mask[lane];
+            job.outFilled = laneMask & ~cross[lane];
+            job.outCrossed = laneMask & ~fill[lane];
+            const bool placed = job.blocks ? first[lane] != 0 : job.filled == 0;
+            job.solvable = job.feasible && placed && ((cross[lane] | fill[lane]) & laneMask) == laneMask;
+        }
+    }
+
+    // Runs jobs through solveLanes in groups of V::LANES.
+    template <class V>
+    void solveJobs(pc::LineJob* jobs, unsigned int count) {
+        for (unsigned int begin = 0; begin < count; begin += V::LANES) {
+            pc::LineJob* group[V::LANES];
+            for (unsigned int lane = 0; lane < V::LANES; lane++) {
+                group[lane] = &jobs[begin + lane < count ? begin + lane : count - 1];
+            }
+            solveLanes<V>(group);
+        }
+    }
+}
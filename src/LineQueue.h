@@ -0,0 +1,85 @@
+/*
+ * LineQueue.h
+ * Namespace pc: Work queue of rows and columns waiting for the line solver.
+ *
+ * A line is queued when one of its cells changes and is never queued twice:
+ * a bitset over all lines remembers which ones are already waiting. Lines come
+ * out first-in first-out, or, with prioritize set, lowest priority value first
+ * so the most constrained lines are solved before the loose ones.
+ */
+#pragma once
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include <vector>
+#include "Grid.h"
+
+namespace pc {
+    class LineQueue {
+        public:
+            LineQueue() : width(0), lines(0), prioritize(false), head(0), count(0) {}
+
+            // Empties the queue and sizes it for a width x height puzzle.
+            void reset(unsigned int width, unsigned int height, bool prioritize) {
+                this->width = width;
+                this->lines = width + height;
+                this->prioritize = prioritize;
+                this->queued.assign(wordsFor(this->lines), 0);
+                this->fifo.resize(this->lines);
+                this->heap.clear();
+                this->head = this->count = 0;
+            }
+
+            void push(unsigned char crs, unsigned int cr, unsigned int priority = 0) {
+                const unsigned int line = crs ? this->width + cr : cr;
+                word& bit = this->queued[line / WORD_BITS];
+                const word mask = word(1) << (line % WORD_BITS);
+                if (bit & mask) return;
+                bit |= mask;
+                if (this->prioritize) {
+                    this->heap.push_back(std::make_pair(priority, line));
+                    std::push_heap(this->heap.begin(), this->heap.end(), std::greater<std::pair<unsigned int, unsigned int>>());
+                }
+                else {
+                    this->fifo[(this->head + this->count) % this->lines] = line;
+                }
+                this->count++;
+            }
+
+            bool pop(unsigned char& crs, unsigned int& cr) {
+                if (!this->count) return false;
+                unsigned int line;
+                if (this->prioritize) {
+                    std::pop_heap(this->heap.begin(), this->heap.end(), std::greater<std::pair<unsigned int, unsigned int>>());
+                    line = this->heap.back().second;
+                    this->heap.pop_back();
+                }
+                else {
+                    line = this->fifo[this->head];
+                    this->head = (this->head + 1) % this->lines;
+                }
+                this->count--;
+                this->queued[line / WORD_BITS] &= ~(word(1) << (line % WORD_BITS));
+                crs = line >= this->width;
+                cr = crs ? line - this->width : line;
+                return true;
+            }
+
+            inline bool empty() const { return !this->count; }
+            inline unsigned int size() const { return this->count; }
+
+            void clear() {
+                std::fill(this->queued.begin(), this->queued.end(), 0);
+                this->heap.clear();
+                this->head = this->count = 0;
+            }
+
+        private:
+            unsigned int width, lines;
+            bool prioritize;
+            std::vector<word> queued;
+            std::vector<unsigned int> fifo;
+            std::vector<std::pair<unsigned int, unsigned int>> heap;
+            unsigned int head, count;
+    };
+};
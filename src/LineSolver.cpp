@@ -0,0 +1,94 @@
+#include "LineSolver.h"
+
+bool pc::LineSolver::deduce(const uint16_t* clues, unsigned int count, unsigned int length,
+                            const word* filled, const word* crossed) {
+    this->blocks.clear();
+    for (unsigned int i = 0; i < count; i++) {
+        if (clues[i]) this->blocks.push_back(clues[i]);
+    }
+    const unsigned int k = this->blocks.size(), n = length;
+    // A virtual crossed cell at position n lets the last block end the line
+    // the same way every other block ends: followed by a cross.
+    const unsigned int cells = n + 1, stride = k + 1;
+
+    this->state.resize(cells);
+    this->crossedBefore.resize(cells + 1);
+    this->crossedBefore[0] = 0;
+    for (unsigned int i = 0; i < n; i++) {
+        const word bit = word(1) << (i % WORD_BITS);
+        this->state[i] = (filled[i / WORD_BITS] & bit) ? FILLED : (crossed[i / WORD_BITS] & bit) ? CROSSED : UNKNOWN;
+        this->crossedBefore[i + 1] = this->crossedBefore[i] + (this->state[i] == CROSSED);
+    }
+    this->state[n] = CROSSED;
+    this->crossedBefore[cells] = this->crossedBefore[n] + 1;
+
+    // Block j can occupy [i, i + blocks[j]) followed by a cross.
+    auto fits = [&](unsigned int i, unsigned int j) {
+        const unsigned int end = i + this->blocks[j];
+        return end <= n && this->crossedBefore[end] == this->crossedBefore[i] && this->state[end] != FILLED;
+    };
+
+    // forward[i][j]: cells [0, i) can hold exactly the first j blocks.
+    this->forward.assign((cells + 1) * stride, 0);
+    this->forward[0] = 1;
+    for (unsigned int i = 0; i < cells; i++) {
+        for (unsigned int j = 0; j <= k; j++) {
+            if (!this->forward[i * stride + j]) continue;
+            if (this->state[i] != FILLED) this->forward[(i + 1) * stride + j] = 1;
+            if (j < k && fits(i, j)) this->forward[(i + this->blocks[j] + 1) * stride + j + 1] = 1;
+        }
+    }
+    if (!this->forward[cells * stride + k]) return false;
+
+    // backward[i][j]: cells [i, n] can hold exactly blocks j onwards.
+    this->backward.assign((cells + 1) * stride, 0);
+    this->backward[cells * stride + k] = 1;
+    for (int i = cells - 1; i >= 0; i--) {
+        for (unsigned int j = 0; j <= k; j++) {
+            bool possible = this->state[i] != FILLED && this->backward[(i + 1) * stride + j];
+            if (!possible && j < k && fits(i, j)) {
+                possible = this->backward[(i + this->blocks[j] + 1) * stride + j + 1];
+            }
+            this->backward[i * stride + j] = possible;
+        }
+    }
+
+    // Record which states every cell can take in some full placement. Filled
+    // ranges go into a difference array so each placement costs O(1).
+    this->fillCoverage.assign(cells + 1, 0);
+    this->crossable.assign(cells, 0);
+    for (unsigned int i = 0; i < cells; i++) {
+        for (unsigned int j = 0; j <= k; j++) {
+            if (!this->forward[i * stride + j]) continue;
+            if (this->state[i] != FILLED && this->backward[(i + 1) * stride + j]) this->crossable[i] = 1;
+            if (j < k && fits(i, j) && this->backward[(i + this->blocks[j] + 1) * stride + j + 1]) {
+                this->fillCoverage[i]++;
+                this->fillCoverage[i + this->blocks[j]]--;
+                this->crossable[i + this->blocks[j]] = 1;
+            }
+        }
+    }
+
+    const unsigned int words = wordsFor(n);
+    this->outFilled.assign(words ? words : 1, 0);
+    this->outCrossed.assign(words ? words : 1, 0);
+    int coverage = 0;
+    for (unsigned int i = 0; i < n; i++) {
+        coverage += this->fillCoverage[i];
+        const word bit = word(1) << (i % WORD_BITS);
+        if (coverage > 0 && !this->crossable[i]) this->outFilled[i / WORD_BITS] |= bit;
+        else if (coverage <= 0 && this->crossable[i]) this->outCrossed[i / WORD_BITS] |= bit;
+        else if (coverage <= 0) return false;
+    }
+    return true;
+}
+
+pc::LineResult pc::LineSolver::solve(Grid& grid, unsigned char crs, unsigned int cr, ClueLine clues) {
+    this->changed = 0;
+    if (!this->deduce(clues.data(), clues.size(), grid.lineLength(crs), grid.filled(crs, cr), grid.crossed(crs, cr))) {
+        return LINE_CONTRADICTION;
+    }
+    this->changedMask.resize(this->outFilled.size());
+    this->changed = grid.merge(crs, cr, this->getFilled(), this->getCrossed(), &this->changedMask[0]);
+    return this->changed ? LINE_CHANGED : LINE_UNCHANGED;
+}
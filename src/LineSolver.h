@@ -0,0 +1,56 @@
+/*
+ * LineSolver.h
+ * Namespace pc: Complete solver for a single row or column.
+ *
+ * Given a line's clues and its partially known cells, finds every cell that is
+ * the same in all legal placements of the blocks. Two dynamic programs run over
+ * (cell, block) pairs: one from the left end, recording which prefixes can hold
+ * the first j blocks, and one from the right end for the remaining blocks. A
+ * block can start at cell i only if both halves fit around it, so the union of
+ * those placements is exactly the set of cells that can be filled. Cells that
+ * only one state can take are forced. Runs in O(length * clues).
+ */
+#pragma once
+#include <vector>
+#include "Grid.h"
+#include "Puzzle.h"
+
+namespace pc {
+    enum LineResult {
+        LINE_UNCHANGED,     // Nothing new could be deduced.
+        LINE_CHANGED,       // At least one unknown cell became known.
+        LINE_CONTRADICTION  // No placement of the clues fits the known cells.
+    };
+
+    class LineSolver {
+        public:
+            /*
+             * Deduces the line described by the clues and the known cells.
+             * Zero-valued clues are ignored, so {0} is an empty line. Returns
+             * false if the line has no legal placement; otherwise getFilled()
+             * and getCrossed() hold every cell known after deduction.
+             */
+            bool deduce(const uint16_t* clues, unsigned int count, unsigned int length,
+                        const word* filled, const word* crossed);
+
+            // Deduces line cr of the grid and merges the result into it.
+            LineResult solve(Grid& grid, unsigned char crs, unsigned int cr, ClueLine clues);
+
+            inline const word* getFilled() const { return &this->outFilled[0]; }
+            inline const word* getCrossed() const { return &this->outCrossed[0]; }
+            // Cells changed by the last call to solve(), as a count and a mask.
+            inline unsigned int getChanged() const { return this->changed; }
+            inline const word* getChangedMask() const { return &this->changedMask[0]; }
+
+        private:
+            // Scratch reused between calls so steady-state solving does not allocate.
+            std::vector<unsigned int> blocks;
+            std::vector<unsigned int> crossedBefore;
+            std::vector<uint8_t> state;
+            std::vector<uint8_t> forward, backward;
+            std::vector<int> fillCoverage;
+            std::vector<uint8_t> crossable;
+            std::vector<word> outFilled, outCrossed, changedMask;
+            unsigned int changed = 0;
+    };
+};
@@ -0,0 +1,114 @@
+#include <algorithm>
+#include "Instrument.h"
+#include "LineKernel.h"
+#include "LineSolver.h"
+#include "ParallelSweep.h"
+
+pc::Status pc::parallelPropagate(Grid& picross, const ClueList& rows, const ClueList& columns,
+                                 ThreadPool& pool, SolveStats* stats, SolveBudget* budget) {
+    // One line solver and one stats block per worker, plus one for the caller.
+    const unsigned int slots = pool.size() + 1;
+    std::vector<LineSolver> lineSolvers(slots);
+    std::vector<SolveStats> workerStats(slots);
+    auto slot = [&]() { const int worker = pool.currentWorker(); return worker >= 0 ? worker : pool.size(); };
+
+    // dirty[crs]: bitset over the lines of crs still waiting to be solved.
+    std::vector<word> dirty[2];
+    for (unsigned char crs = COLUMNS; crs <= ROWS; crs++) {
+        dirty[crs].assign(wordsFor(picross.lineCount(crs)), 0);
+        setRange(&dirty[crs][0], 0, picross.lineCount(crs));
+    }
+    std::vector<unsigned int> lines;
+    std::vector<word> changed;
+    std::vector<uint8_t> contradiction;
+
+    bool progress = true;
+    while (progress) {
+        progress = false;
+        PC_COUNT(stats, rounds, 1);
+        for (unsigned char crs : {ROWS, COLUMNS}) {
+            const ClueList& crv = crs ? rows : columns;
+            const unsigned int words = picross.lineWords(crs), count = picross.lineCount(crs);
+
+            lines.clear();
+            for (unsigned int w = 0; w < dirty[crs].size(); w++) {
+                for (word m = dirty[crs][w]; m; m &= m - 1) lines.push_back(w * WORD_BITS + __builtin_ctzll(m));
+                dirty[crs][w] = 0;
+            }
+            if (!lines.empty()) {
+                changed.assign(size_t(count) * words, 0);
+                contradiction.assign(lines.size(), 0);
+
+                // Solve: line i only reads and writes its own words.
+                pool.parallelFor(lines.size(), 8, [&](size_t begin, size_t end) {
+                    LineSolver& lineSolver = lineSolvers[slot()];
+                    SolveStats& local = workerStats[slot()];
+                    if (picross.lineLength(crs) <= LINE_KERNEL_LENGTH) {
+                        // Lines of one word go through the line kernel a few at a time.
+                        LineJob jobs[LINE_KERNEL_LANES_MAX];
+                        for (size_t first = begin; first < end; first += LINE_KERNEL_LANES_MAX) {
+                            const unsigned int jobCount = std::min<size_t>(end - first, LINE_KERNEL_LANES_MAX);
+                            for (unsigned int j = 0; j < jobCount; j++) {
+                                const unsigned int cr = lines[first + j];
+                                setLineJob(jobs[j], crv[cr].data(), crv[cr].size(), picross.lineLength(crs),
+                                           picross.filled(crs, cr)[0], picross.crossed(crs, cr)[0]);
+                            }
+                            solveLineJobs(jobs, jobCount);
+                            for (unsigned int j = 0; j < jobCount; j++) {
+                                const unsigned int cr = lines[first + j];
+                                local.lineSolves++;
+                                if (!jobs[j].solvable) {
+                                    contradiction[first + j] = 1;
+                                    continue;
+                                }
+                                local.cellsChanged += picross.mergeLine(crs, cr, &jobs[j].outFilled, &jobs[j].outCrossed,
+                                                                        &changed[size_t(cr) * words]);
+                            }
+                        }
+                        return;
+                    }
+                    for (size_t i = begin; i < end; i++) {
+                        const unsigned int cr = lines[i];
+                        local.lineSolves++;
+                        if (!lineSolver.deduce(crv[cr].data(), crv[cr].size(), picross.lineLength(crs),
+                                               picross.filled(crs, cr), picross.crossed(crs, cr))) {
+                            contradiction[i] = 1;
+                            continue;
+                        }
+                        local.cellsChanged += picross.mergeLine(crs, cr, lineSolver.getFilled(), lineSolver.getCrossed(),
+                                                                &changed[size_t(cr) * words]);
+                    }
+                });
+                if (std::find(contradiction.begin(), contradiction.end(), 1) != contradiction.end()) {
+                    if (stats) for (auto& s : workerStats) addStats(*stats, s);
+                    return CONTRADICTION;
+                }
+
+                // Copy into the crossing lines, one 64-line block per task.
+                pool.parallelFor(wordsFor(count), 1, [&](size_t begin, size_t end) {
+                    for (unsigned int cr = begin * WORD_BITS; cr < std::min<size_t>(end * WORD_BITS, count); cr++) {
+                        picross.syncCrossing(crs, cr, &changed[size_t(cr) * words]);
+                    }
+                });
+
+                // Any crossing line with a changed cell is dirty: OR of the masks.
+                std::vector<word>& next = dirty[!crs];
+                for (unsigned int cr = 0; cr < count; cr++) {
+                    for (unsigned int w = 0; w < words; w++) {
+                        if (changed[size_t(cr) * words + w]) {
+                            next[w] |= changed[size_t(cr) * words + w];
+                            progress = true;
+                        }
+                    }
+                }
+                if (budget && budget->spend(lines.size(), picross)) {
+                    if (stats) for (auto& s : workerStats) addStats(*stats, s);
+                    return STOPPED;
+                }
+            }
+        }
+    }
+    if (stats) for (auto& s : workerStats) addStats(*stats, s);
+    PC_PHASE(stats, checkNanos);
+    return picross.isSolved() ? SOLVED : STUCK;
+}
@@ -0,0 +1,27 @@
+/*
+ * ParallelSweep.h
+ * Namespace pc: Propagation that solves a whole direction of lines at once.
+ *
+ * Against a fixed state of the columns, every row can be solved on its own,
+ * and the same holds for columns against the rows. A round therefore solves
+ * all dirty rows concurrently on the thread pool, copies their changes into
+ * the column bitplanes, and then does the same for the dirty columns. Each
+ * line only writes its own words and each copy task owns one 64-line block
+ * of the crossing words, so no locks are needed anywhere.
+ */
+#pragma once
+#include <vector>
+#include "Grid.h"
+#include "Solver.h"
+#include "ThreadPool.h"
+
+namespace pc {
+    /*
+     * Propagates every line of the grid to a fixed point using the pool. The
+     * grid must not be trailing. Same results as propagate() over a queue
+     * holding every line. The budget, if any, is checked after each half
+     * round and can stop it with STOPPED.
+     */
+    Status parallelPropagate(Grid& picross, const ClueList& rows, const ClueList& columns,
+                             ThreadPool& pool, SolveStats* stats, SolveBudget* budget = nullptr);
+};
@@ -0,0 +1,212 @@
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "PlacementTable.h"
+
+namespace {
+    /*
+     * File and in-memory layout, in 32-bit words: the magic (two words), the
+     * version, maxLength, the total word count and the word offset of each
+     * length's section, 0 to PLACEMENT_MAX_LENGTH. A section is its clue
+     * count, then its keys, the offset of each clue's first filling and each
+     * clue's filling count, then the fillings.
+     */
+    const char MAGIC[8] = {'P', 'C', 'P', 'L', 'A', 'C', 'E', 'S'};
+    const uint32_t VERSION = 1;
+    const unsigned int OFFSETS = 5, HEADER_WORDS = OFFSETS + pc::PLACEMENT_MAX_LENGTH + 1;
+
+    struct Builder {
+        unsigned int length;
+        std::vector<unsigned int> runs;
+        std::vector<uint32_t> keys, begin, size, patterns;
+    };
+
+    // Every placement of runs[block..] at or after cell from.
+    void addPlacements(Builder& builder, unsigned int block, unsigned int from, uint32_t bits) {
+        if (block == builder.runs.size()) {
+            builder.patterns.push_back(bits);
+            return;
+        }
+        unsigned int rest = 0;
+        for (unsigned int r = block + 1; r < builder.runs.size(); r++) rest += builder.runs[r] + 1;
+        const unsigned int run = builder.runs[block];
+        for (unsigned int start = from; start + run + rest <= builder.length; start++) {
+            addPlacements(builder, block + 1, start + run + 1, bits | (((uint32_t(1) << run) - 1) << start));
+        }
+    }
+
+    // The clue in runs, whose leftmost placement is key, and every clue extending it from cell next.
+    void addClues(Builder& builder, unsigned int next, uint32_t key) {
+        builder.keys.push_back(key);
+        builder.begin.push_back(builder.patterns.size());
+        addPlacements(builder, 0, 0, 0);
+        builder.size.push_back(builder.patterns.size() - builder.begin.back());
+        for (unsigned int run = 1; next + run <= builder.length; run++) {
+            builder.runs.push_back(run);
+            addClues(builder, next + run + 1, key | (((uint32_t(1) << run) - 1) << next));
+            builder.runs.pop_back();
+        }
+    }
+}
+
+pc::PlacementTable::PlacementTable() : words(nullptr), wordCount(0), maxLength(0), sections(), mapping(nullptr), mappingBytes(0) {}
+
+pc::PlacementTable::~PlacementTable() {
+    this->clear();
+}
+
+void pc::PlacementTable::clear() {
+    if (this->mapping) munmap(this->mapping, this->mappingBytes);
+    this->mapping = nullptr;
+    this->mappingBytes = 0;
+    std::vector<uint32_t>().swap(this->built);
+    this->words = nullptr;
+    this->wordCount = 0;
+    this->maxLength = 0;
+}
+
+bool pc::PlacementTable::build(unsigned int maxLength) {
+    this->clear();
+    if (!maxLength || maxLength > PLACEMENT_MAX_LENGTH) {
+        this->error = "line length must be 1 to " + std::to_string(PLACEMENT_MAX_LENGTH);
+        return false;
+    }
+    std::vector<uint32_t>& out = this->built;
+    out.assign(HEADER_WORDS, 0);
+    memcpy(out.data(), MAGIC, sizeof(MAGIC));
+    out[2] = VERSION;
+    out[3] = maxLength;
+    for (unsigned int length = 1; length <= maxLength; length++) {
+        Builder builder;
+        builder.length = length;
+        addClues(builder, 0, 0);
+
+        // Lay the index out in key order; the fillings stay where they are.
+        const uint32_t clues = builder.keys.size();
+        std::vector<uint32_t> order(clues);
+        for (uint32_t c = 0; c < clues; c++) order[c] = c;
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return builder.keys[a] < builder.keys[b]; });
+        const size_t section = out.size(), patterns = section + 1 + 3 * size_t(clues);
+        out[OFFSETS + length] = section;
+        out.push_back(clues);
+        for (uint32_t c : order) out.push_back(builder.keys[c]);
+        for (uint32_t c : order) out.push_back(patterns + builder.begin[c]);
+        for (uint32_t c : order) out.push_back(builder.size[c]);
+        out.insert(out.end(), builder.patterns.begin(), builder.patterns.end());
+    }
+    out[4] = out.size();
+    this->words = out.data();
+    this->wordCount = out.size();
+    return this->index();
+}
+
+bool pc::PlacementTable::save(const std::string& path) const {
+    if (!this->words) return false;
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(this->words), this->getBytes());
+    file.close();
+    return file.good();
+}
+
+bool pc::PlacementTable::load(const std::string& path) {
+    this->clear();
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        this->error = "could not open " + path;
+        return false;
+    }
+    struct stat status;
+    void* mapped = MAP_FAILED;
+    if (!fstat(fd, &status) && size_t(status.st_size) >= HEADER_WORDS * sizeof(uint32_t)) {
+        mapped = mmap(nullptr, status.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        this->error = path + " is not a placement table";
+        return false;
+    }
+    this->mapping = mapped;
+    this->mappingBytes = status.st_size;
+    this->words = static_cast<const uint32_t*>(mapped);
+    this->wordCount = status.st_size / sizeof(uint32_t);
+    if (memcmp(this->words, MAGIC, sizeof(MAGIC)) || this->words[2] != VERSION || this->words[4] != this->wordCount ||
+        !this->words[3] || this->words[3] > PLACEMENT_MAX_LENGTH) {
+        this->clear();
+        this->error = path + " is not a placement table of this version";
+        return false;
+    }
+    if (!this->index()) {
+        this->clear();
+        this->error = path + " has a damaged index";
+        return false;
+    }
+    return true;
+}
+
+bool pc::PlacementTable::index() {
+    this->maxLength = this->words[3];
+    for (unsigned int length = 1; length <= this->maxLength; length++) {
+        const size_t section = this->words[OFFSETS + length];
+        if (section >= this->wordCount) return false;
+        const size_t clues = this->words[section];
+        if (section + 1 + 3 * clues > this->wordCount) return false;
+        Section& s = this->sections[length];
+        s.clues = clues;
+        s.keys = this->words + section + 1;
+        s.begin = s.keys + clues;
+        s.size = s.begin + clues;
+        for (size_t c = 0; c < clues; c++) {
+            if (size_t(s.begin[c]) + s.size[c] > this->wordCount) return false;
+        }
+    }
+    return true;
+}
+
+bool pc::PlacementTable::solve(LineJob& job) const {
+    if (!job.length || job.length > this->maxLength) return false;
+    const Section& section = this->sections[job.length];
+    const uint32_t mask = (uint32_t(1) << job.length) - 1;
+
+    // The leftmost placement, if the blocks fit at all.
+    uint32_t key = 0;
+    unsigned int next = 0;
+    bool fits = job.feasible;
+    for (unsigned int b = 0; b < job.blocks && fits; b++) {
+        const unsigned int run = job.block[b];
+        fits = next + run <= job.length;
+        if (fits) key |= ((uint32_t(1) << run) - 1) << next;
+        next += run + 1;
+    }
+    // Binary search without branches on the keys, which are random.
+    const uint32_t* found = section.keys;
+    for (size_t n = section.clues; n > 1; n -= n / 2) {
+        if (found[n / 2] <= key) found += n / 2;
+    }
+    if (!fits || *found != key) {
+        job.solvable = false;
+        return true;
+    }
+    const size_t c = found - section.keys;
+    if (section.size[c] > PLACEMENT_SCAN_LIMIT) return false;
+
+    // Branch-free, so the scan vectorizes.
+    const uint32_t* patterns = this->words + section.begin[c];
+    const uint32_t filled = job.filled, crossed = job.crossed;
+    uint32_t always = mask, ever = 0;
+    for (uint32_t p = 0; p < section.size[c]; p++) {
+        const uint32_t pattern = patterns[p];
+        const uint32_t agrees = -uint32_t(!((pattern & crossed) | (filled & ~pattern)));
+        always &= pattern | ~agrees;
+        ever |= pattern & agrees;
+    }
+    // Nothing agreed: always is still the whole line.
+    job.solvable = !(always & ~ever);
+    if (!job.solvable) return true;
+    job.outFilled = filled | always;
+    job.outCrossed = crossed | (mask & ~ever);
+    return true;
+}
@@ -0,0 +1,83 @@
+/*
+ * PlacementTable.h
+ * Namespace pc: Every filling of every clue for lines up to a given length.
+ *
+ * A short line has few enough fillings that all of them can be listed once:
+ * 2^n for an n-cell line, grouped by the clue each one produces. Solving a
+ * line is then a scan of its clue's group for the fillings that agree with
+ * the known cells. A cell filled in all of them (their AND) or in none (their
+ * OR) is known, which is the same result as LineSolver::deduce. Clues with
+ * more than PLACEMENT_SCAN_LIMIT fillings are left to the line kernel, which
+ * is faster on them.
+ *
+ * A table for lines of 1 to maxLength cells holds 2^(maxLength + 1) fillings
+ * plus an index: about 8 MiB at 20 cells and 256 MiB at PLACEMENT_MAX_LENGTH.
+ * build() fills one in memory. save() writes it to a file that load() maps
+ * read-only, so starting a batch costs one mmap and a check of the index
+ * instead of regenerating it, and every process using the file shares one
+ * copy in the page cache. Files are in native byte order.
+ *
+ * A clue's key is its leftmost placement: the blocks packed from cell 0 with
+ * one gap each. It is different for every clue and fits in the line's bits.
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "LineKernel.h"
+
+namespace pc {
+    const unsigned int PLACEMENT_MAX_LENGTH = 25; // Longest line a table can hold.
+    const unsigned int PLACEMENT_SCAN_LIMIT = 64;  // Most fillings solve() scans for one line.
+
+    class PlacementTable {
+        public:
+            PlacementTable();
+            ~PlacementTable();
+            PlacementTable(const PlacementTable&) = delete;
+            PlacementTable& operator=(const PlacementTable&) = delete;
+
+            // Fills the table for lines of 1 to maxLength cells in memory.
+            bool build(unsigned int maxLength);
+            // Writes the table to path, for load().
+            bool save(const std::string& path) const;
+            // Maps a table written by save(); false, leaving it empty, if the file is not one.
+            bool load(const std::string& path);
+
+            /*
+             * Solves a job filled in by setLineJob, as solveLineJobs would.
+             * False, with the job untouched, if the line is longer than the
+             * table covers.
+             */
+            bool solve(LineJob& job) const;
+
+            // Longest line covered; 0 for an empty table.
+            inline unsigned int getMaxLength() const { return this->maxLength; }
+            inline size_t getBytes() const { return this->wordCount * sizeof(uint32_t); }
+            inline const std::string& getError() const { return this->error; }
+
+        private:
+            // The index of the lines of one length, inside words.
+            struct Section {
+                const uint32_t* keys; // Sorted.
+                const uint32_t* begin;
+                const uint32_t* size;
+                unsigned int clues;
+            };
+
+            void clear();
+            // Points the sections into words; false if the index is malformed.
+            bool index();
+
+            const uint32_t* words;
+            size_t wordCount;
+            unsigned int maxLength;
+            Section sections[PLACEMENT_MAX_LENGTH + 1];
+            // Where words lives: built, or a mapping of a file.
+            std::vector<uint32_t> built;
+            void* mapping;
+            size_t mappingBytes;
+            std::string error;
+    };
+};
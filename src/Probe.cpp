@@ -0,0 +1,185 @@
+#include <algorithm>
+#include "Probe.h"
+
+namespace {
+    /*
+     * Bit of a line in the mask of lines a probe solved. Lines share bits
+     * modulo 32, which only costs a cell an extra probe now and then.
+     */
+    inline uint64_t lineBit(unsigned char crs, unsigned int cr) {
+        return uint64_t(1) << (crs ? cr % 32 : 32 + cr % 32);
+    }
+
+    // Copies the row planes of picross into out: every row's filled words, then every row's crossed words.
+    void saveRows(const pc::Grid& picross, std::vector<pc::word>& out) {
+        const unsigned int words = picross.lineWords(pc::ROWS);
+        const size_t plane = size_t(picross.getHeight()) * words;
+        out.resize(2 * plane);
+        for (unsigned int row = 0; row < picross.getHeight(); row++) {
+            std::copy(picross.filled(pc::ROWS, row), picross.filled(pc::ROWS, row) + words, &out[row * words]);
+            std::copy(picross.crossed(pc::ROWS, row), picross.crossed(pc::ROWS, row) + words, &out[plane + row * words]);
+        }
+    }
+
+    /*
+     * Mask of the lines with cells known in picross but not in saved, the
+     * rows of picross as saveRows() left them; cells receives how many.
+     */
+    uint64_t changedLines(const pc::Grid& picross, const std::vector<pc::word>& saved, unsigned long long& cells) {
+        const unsigned int words = picross.lineWords(pc::ROWS);
+        const size_t plane = size_t(picross.getHeight()) * words;
+        uint64_t lines = 0, columns = 0;
+        cells = 0;
+        for (unsigned int row = 0; row < picross.getHeight(); row++) {
+            const pc::word* filled = picross.filled(pc::ROWS, row);
+            const pc::word* crossed = picross.crossed(pc::ROWS, row);
+            for (unsigned int w = 0; w < words; w++) {
+                const pc::word gained = (filled[w] | crossed[w]) & ~(saved[row * words + w] | saved[plane + row * words + w]);
+                if (!gained) continue;
+                cells += __builtin_popcountll(gained);
+                lines |= lineBit(pc::ROWS, row);
+                // Column c is bit c % 64 of its word, and 64 is a multiple of 32.
+                columns |= gained | (gained >> 32);
+            }
+        }
+        return lines | (columns & 0xffffffffu) << 32;
+    }
+}
+
+pc::Status pc::probe(Grid& picross, const ClueList& rows, const ClueList& columns, SolveScratch& scratch,
+                     const SolveOptions& options, SolveStats* stats, SolveBudget* budget) {
+    const unsigned int width = picross.getWidth(), height = picross.getHeight();
+    const unsigned int words = picross.lineWords(ROWS);
+    const size_t plane = size_t(height) * words;
+    LineQueue& queue = scratch.queue;
+    std::vector<word>& base = scratch.probeBase;
+    std::vector<word>& side = scratch.probeSide;
+    std::vector<unsigned long long>& stamps = scratch.probeStamps;
+    std::vector<uint64_t>& probed = scratch.probeLines;
+    stamps.assign(size_t(width) * height, 0);
+    probed.resize(stamps.size());
+    // The grid's version, bumped by every deduction, and the version at which
+    // the lines of each bit of a mask last gained cells.
+    unsigned long long version = 1;
+    unsigned long long lineVersions[64] = {};
+    auto stale = [&](size_t cell) {
+        for (uint64_t lines = probed[cell]; lines; lines &= lines - 1) {
+            if (lineVersions[__builtin_ctzll(lines)] > stamps[cell]) return true;
+        }
+        return false;
+    };
+    auto guess = [&](unsigned int row, unsigned int column, uint8_t state) {
+        picross.set(row, column, state);
+        queue.push(ROWS, row, 0);
+        queue.push(COLUMNS, column, 0);
+        return propagate(picross, rows, columns, queue, scratch.lineSolver, options, stats, nullptr, budget);
+    };
+
+    bool forced = true;
+    while (forced) {
+        forced = false;
+        // Most constrained first: fewest unknown cells in the row and column together.
+        std::vector<unsigned int>& columnUnknown = scratch.probeCounts;
+        columnUnknown.resize(width);
+        for (unsigned int column = 0; column < width; column++) {
+            columnUnknown[column] = height - picross.countKnown(COLUMNS, column);
+        }
+        std::vector<uint64_t>& order = scratch.probeOrder;
+        order.clear();
+        for (unsigned int row = 0; row < height; row++) {
+            const unsigned int rowUnknown = width - picross.countKnown(ROWS, row);
+            const word* filled = picross.filled(ROWS, row);
+            const word* crossed = picross.crossed(ROWS, row);
+            for (unsigned int w = 0; w < words; w++) {
+                for (word unknown = ~(filled[w] | crossed[w]) & lineMask(width, w); unknown; unknown &= unknown - 1) {
+                    const unsigned int column = w * WORD_BITS + __builtin_ctzll(unknown);
+                    order.push_back(uint64_t(rowUnknown + columnUnknown[column]) << 32 | (size_t(row) * width + column));
+                }
+            }
+        }
+        std::sort(order.begin(), order.end());
+
+        for (const uint64_t entry : order) {
+            const size_t cell = entry & 0xffffffffu;
+            const unsigned int row = cell / width, column = cell % width;
+            if (picross.get(row, column) != UNKNOWN || (stamps[cell] && !stale(cell))) continue;
+            if (stats) stats->probes++;
+            saveRows(picross, base);
+            const size_t mark = picross.trailSize();
+            unsigned long long cells;
+            uint64_t lines = lineBit(ROWS, row) | lineBit(COLUMNS, column);
+
+            const Status filled = guess(row, column, FILLED);
+            if (filled == STOPPED) {
+                picross.undo(mark);
+                queue.clear();
+                return STOPPED;
+            }
+            if (filled != CONTRADICTION) {
+                lines |= changedLines(picross, base, cells);
+                saveRows(picross, side);
+            }
+            picross.undo(mark);
+            Status status = guess(row, column, CROSSED);
+            if (status == STOPPED) {
+                picross.undo(mark);
+                queue.clear();
+                return STOPPED;
+            }
+            if (status == CONTRADICTION) {
+                picross.undo(mark);
+                if (filled == CONTRADICTION) return CONTRADICTION;
+                status = guess(row, column, FILLED);
+            }
+            else if (filled != CONTRADICTION) {
+                // Neither value is ruled out: keep the cells both of them deduced.
+                lines |= changedLines(picross, base, cells);
+                for (unsigned int line = 0; line < height; line++) {
+                    const word* lineFilled = picross.filled(ROWS, line);
+                    const word* lineCrossed = picross.crossed(ROWS, line);
+                    for (unsigned int w = 0; w < words; w++) {
+                        side[line * words + w] &= lineFilled[w];
+                        side[plane + line * words + w] &= lineCrossed[w];
+                    }
+                }
+                picross.undo(mark);
+                side.resize(2 * plane + words);
+                word* changed = &side[2 * plane];
+                bool any = false;
+                for (unsigned int line = 0; line < height; line++) {
+                    if (!picross.merge(ROWS, line, &side[line * words], &side[plane + line * words], changed)) continue;
+                    any = true;
+                    queue.push(ROWS, line, 0);
+                    for (unsigned int w = 0; w < words; w++) {
+                        for (word bits = changed[w]; bits; bits &= bits - 1) {
+                            queue.push(COLUMNS, w * WORD_BITS + __builtin_ctzll(bits), 0);
+                        }
+                    }
+                }
+                if (!any) {
+                    stamps[cell] = version;
+                    probed[cell] = lines;
+                    continue;
+                }
+                status = propagate(picross, rows, columns, queue, scratch.lineSolver, options, stats, nullptr, budget);
+            }
+            // Otherwise only crossed is possible, and the grid already holds its fixed point.
+
+            if (status != STOPPED && status != CONTRADICTION) {
+                forced = true;
+                const uint64_t gained = changedLines(picross, base, cells);
+                if (stats) stats->probeCells += cells;
+                version++;
+                for (uint64_t bits = gained; bits; bits &= bits - 1) lineVersions[__builtin_ctzll(bits)] = version;
+                // Probing this cell again would only find what it just forced.
+                stamps[cell] = version;
+                probed[cell] = lines;
+            }
+            if (status != STUCK) {
+                if (status == STOPPED) queue.clear();
+                return status;
+            }
+        }
+    }
+    return STUCK;
+}
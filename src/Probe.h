@@ -0,0 +1,35 @@
+/*
+ * Probe.h
+ * Namespace pc: Probing, the deduction step between line propagation and
+ * search.
+ *
+ * When propagation is stuck, each unknown cell is tried both ways: set filled
+ * and propagated, then set crossed and propagated. If one value leads to a
+ * contradiction, the cell must take the other. If both reach a fixed point,
+ * every cell the two agree on holds either way. The grid's undo trail takes it
+ * back between the tries, so a probe costs its two propagations plus undoing
+ * the words they changed.
+ *
+ * Cells are tried in order of how constrained their lines are, fewest unknown
+ * cells in their row and column first, and probing goes on until a pass
+ * forces nothing. A probe's result is kept: the cell is only probed again
+ * once a line its propagations solved has gained cells since. Until then both
+ * propagations would solve the same lines with the same cells known and reach
+ * the same fixed points.
+ */
+#pragma once
+#include "Grid.h"
+#include "Puzzle.h"
+#include "Solver.h"
+
+namespace pc {
+    /*
+     * Probes the stuck grid picross, whose lines must all be propagated, until
+     * probing forces nothing more. picross must be trailing; what probing
+     * forces stays on its trail. Returns SOLVED, STUCK, CONTRADICTION if both
+     * values of a cell are contradictions, or STOPPED with the cells forced
+     * before the budget ran out.
+     */
+    Status probe(Grid& picross, const ClueList& rows, const ClueList& columns, SolveScratch& scratch,
+                 const SolveOptions& options, SolveStats* stats, SolveBudget* budget);
+};
@@ -0,0 +1,284 @@
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "Puzzle.h"
+
+static const size_t BLOCK_SIZE = 1 << 20;
+
+static inline bool isDigit(char c) { return c >= '0' && c <= '9'; }
+static inline bool isBlank(char c) { return c == ' ' || c == '\t'; }
+
+static inline bool isKey(const char* begin, const char* end, const char* key) {
+    const size_t length = strlen(key);
+    return size_t(end - begin) == length && !memcmp(begin, key, length);
+}
+
+/*
+ * Parses numbers separated by any of the characters in separators into a new
+ * last line of clues, stopping at end or at the character stop. False on
+ * anything else, on an empty line and on a number above CLUE_MAX.
+ */
+static bool parseClues(const char*& p, const char* end, const char* separators, char stop, pc::ClueList& clues) {
+    clues.addLine();
+    bool any = false;
+    while (p < end && *p != stop) {
+        if (isDigit(*p)) {
+            unsigned int value = 0;
+            while (p < end && isDigit(*p)) {
+                value = value * 10 + (*p++ - '0');
+                if (value > pc::CLUE_MAX) return false;
+            }
+            clues.push(value);
+            any = true;
+        }
+        else if (strchr(separators, *p)) p++;
+        else return false;
+    }
+    return any;
+}
+
+void pc::ClueList::assign(unsigned int lines) {
+    this->offsets.assign(lines + 1, 0);
+    this->values.clear();
+}
+
+bool pc::ClueList::set(unsigned int line, const unsigned int* values, unsigned int count) {
+    if (std::any_of(values, values + count, [](unsigned int value) { return value > CLUE_MAX; })) return false;
+    const uint32_t begin = this->offsets[line], end = this->offsets[line + 1];
+    const int64_t shift = int64_t(count) - (end - begin);
+    if (shift > 0) this->values.insert(this->values.begin() + end, shift, 0);
+    else this->values.erase(this->values.begin() + begin + count, this->values.begin() + end);
+    for (unsigned int i = 0; i < count; i++) this->values[begin + i] = values[i];
+    for (unsigned int l = line + 1; l < this->offsets.size(); l++) this->offsets[l] += shift;
+    return true;
+}
+
+pc::PuzzleReader::PuzzleReader()
+    : fd(-1), data(nullptr), size(0), offset(0), mapping(nullptr), bufferStart(0), bufferEnd(0),
+      streamEnd(false), lineNumber(0), consumed(0) {}
+
+pc::PuzzleReader::~PuzzleReader() {
+    this->close();
+}
+
+bool pc::PuzzleReader::open(const char* filename) {
+    this->close();
+    if (!strcmp(filename, "-")) {
+        this->fd = STDIN_FILENO;
+    }
+    else {
+        this->fd = ::open(filename, O_RDONLY);
+        if (this->fd < 0) {
+            this->error = std::string("could not open ") + filename;
+            return false;
+        }
+        struct stat info;
+        if (!fstat(this->fd, &info) && S_ISREG(info.st_mode) && info.st_size > 0) {
+            void* mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, this->fd, 0);
+            if (mapped != MAP_FAILED) {
+                madvise(mapped, info.st_size, MADV_SEQUENTIAL);
+                this->mapping = mapped;
+                this->data = (const char*)mapped;
+                this->size = info.st_size;
+                return true;
+            }
+        }
+    }
+    // Not mappable (pipe, terminal, empty file): read it in blocks.
+    this->buffer.resize(BLOCK_SIZE);
+    return true;
+}
+
+void pc::PuzzleReader::open(const char* data, size_t size) {
+    this->close();
+    this->data = data;
+    this->size = size;
+}
+
+void pc::PuzzleReader::close() {
+    if (this->mapping) munmap(this->mapping, this->size);
+    if (this->fd > STDIN_FILENO) ::close(this->fd);
+    this->fd = -1;
+    this->mapping = nullptr;
+    this->data = nullptr;
+    this->size = this->offset = 0;
+    this->bufferStart = this->bufferEnd = 0;
+    this->streamEnd = false;
+    this->lineNumber = this->consumed = 0;
+    this->error.clear();
+}
+
+bool pc::PuzzleReader::nextLine(const char*& begin, const char*& end) {
+    if (this->data) {
+        if (this->offset >= this->size) return false;
+        begin = this->data + this->offset;
+        const char* newline = (const char*)memchr(begin, '\n', this->size - this->offset);
+        end = newline ? newline : this->data + this->size;
+        this->offset = end - this->data + (newline ? 1 : 0);
+    }
+    else {
+        if (this->fd < 0) return false;
+        while (true) {
+            char* start = &this->buffer[0] + this->bufferStart;
+            char* newline = (char*)memchr(start, '\n', this->bufferEnd - this->bufferStart);
+            if (newline) {
+                begin = start;
+                end = newline;
+                this->bufferStart = newline + 1 - &this->buffer[0];
+                break;
+            }
+            if (this->streamEnd) {
+                if (this->bufferStart == this->bufferEnd) return false;
+                begin = start;
+                end = &this->buffer[0] + this->bufferEnd;
+                this->bufferStart = this->bufferEnd;
+                break;
+            }
+            // Keep the partial line and refill behind it.
+            memmove(&this->buffer[0], start, this->bufferEnd - this->bufferStart);
+            this->bufferEnd -= this->bufferStart;
+            this->bufferStart = 0;
+            if (this->bufferEnd == this->buffer.size()) this->buffer.resize(2 * this->buffer.size());
+            const ssize_t bytes = read(this->fd, &this->buffer[0] + this->bufferEnd, this->buffer.size() - this->bufferEnd);
+            if (bytes <= 0) this->streamEnd = true;
+            else this->bufferEnd += bytes;
+        }
+    }
+    this->consumed += end - begin + 1;
+    this->lineNumber++;
+    if (end > begin && end[-1] == '\r') end--;
+    return true;
+}
+
+bool pc::PuzzleReader::nextContentLine(const char*& begin, const char*& end) {
+    while (this->nextLine(begin, end)) {
+        while (begin < end && isBlank(*begin)) begin++;
+        while (end > begin && isBlank(end[-1])) end--;
+        if (begin < end && *begin != '#') return true;
+    }
+    return false;
+}
+
+bool pc::PuzzleReader::fail(const char* message) {
+    this->error = "line " + std::to_string(this->lineNumber) + ": " + message;
+    return false;
+}
+
+bool pc::PuzzleReader::next(Puzzle& puzzle) {
+    this->error.clear();
+    const char* begin;
+    const char* end;
+    if (!this->nextContentLine(begin, end)) return false;
+    if (isDigit(*begin)) return this->readCompact(puzzle, begin, end);
+    return this->readNon(puzzle, begin, end);
+}
+
+bool pc::PuzzleReader::readCompact(Puzzle& puzzle, const char* begin, const char* end) {
+    // Count the lines of each half first so the clue storage can be sized.
+    const char* bar = (const char*)memchr(begin, '|', end - begin);
+    if (!bar) return this->fail("expected '|' between row and column clues");
+    const unsigned int height = std::count(begin, bar, ',') + 1;
+    const unsigned int width = std::count(bar + 1, end, ',') + 1;
+    if (width > CLUE_MAX || height > CLUE_MAX) return this->fail("more than 65535 lines a side");
+    puzzle.width = width;
+    puzzle.height = height;
+    puzzle.rows.clear();
+    puzzle.columns.clear();
+
+    const char* p = begin;
+    for (unsigned int row = 0; row < height; row++) {
+        if (!parseClues(p, bar, ".", ',', puzzle.rows)) return this->fail("bad row clue");
+        p++;
+    }
+    p = bar + 1;
+    for (unsigned int column = 0; column < width; column++) {
+        if (!parseClues(p, end, ".", ',', puzzle.columns)) return this->fail("bad column clue");
+        p++;
+    }
+    return true;
+}
+
+bool pc::PuzzleReader::readNon(Puzzle& puzzle, const char* begin, const char* end) {
+    unsigned int width = 0, height = 0;
+    bool haveRows = false, haveColumns = false, started = false;
+    do {
+        const char* keyEnd = begin;
+        while (keyEnd < end && !isBlank(*keyEnd)) keyEnd++;
+        const char* value = keyEnd;
+        while (value < end && isBlank(*value)) value++;
+
+        if (isKey(begin, keyEnd, "width") || isKey(begin, keyEnd, "height")) {
+            if (haveRows || haveColumns) return this->fail("width or height after the clues");
+            // Digits to the end of the line, and no more than a clue can span.
+            unsigned int number = 0;
+            while (value < end && isDigit(*value) && number <= CLUE_MAX) number = number * 10 + (*value++ - '0');
+            if (value < end || !number || number > CLUE_MAX) return this->fail("bad width or height");
+            (isKey(begin, keyEnd, "width") ? width : height) = number;
+            started = true;
+        }
+        else if (isKey(begin, keyEnd, "rows") || isKey(begin, keyEnd, "columns")) {
+            const bool rows = isKey(begin, keyEnd, "rows");
+            if (!width || !height) return this->fail("clues before width and height");
+            if (!haveRows && !haveColumns) puzzle.resize(width, height);
+            ClueList& clues = rows ? puzzle.rows : puzzle.columns;
+            clues.clear();
+            for (unsigned int line = 0; line < (rows ? height : width); line++) {
+                const char* lineBegin;
+                const char* lineEnd;
+                if (!this->nextContentLine(lineBegin, lineEnd)) return this->fail("missing clues");
+                if (!parseClues(lineBegin, lineEnd, ", \t", '\0', clues)) return this->fail("bad clue");
+            }
+            (rows ? haveRows : haveColumns) = true;
+            started = true;
+            if (haveRows && haveColumns) return true;
+        }
+        // A compact puzzle ends the metadata, which belonged to the block
+        // before it (goal after the clues, say) if no block has started.
+        else if (isDigit(*begin)) {
+            if (started) return this->fail("compact puzzle inside an unfinished .non puzzle");
+            return this->readCompact(puzzle, begin, end);
+        }
+        // Anything else (title, catalogue, goal, ...) is metadata.
+    } while (this->nextContentLine(begin, end));
+    if (started) return this->fail("incomplete puzzle at end of input");
+    return false;
+}
+
+void pc::appendCompact(std::string& out, const Puzzle& puzzle) {
+    auto appendLines = [&](const ClueList& lines) {
+        for (unsigned int i = 0; i < lines.size(); i++) {
+            if (i) out += ',';
+            if (lines[i].empty()) out += '0';
+            for (unsigned int j = 0; j < lines[i].size(); j++) {
+                if (j) out += '.';
+                out += std::to_string(lines[i][j]);
+            }
+        }
+    };
+    appendLines(puzzle.rows);
+    out += '|';
+    appendLines(puzzle.columns);
+    out += '\n';
+}
+
+void pc::appendNon(std::string& out, const Puzzle& puzzle) {
+    auto appendLines = [&](const ClueList& lines) {
+        for (unsigned int i = 0; i < lines.size(); i++) {
+            const ClueLine line = lines[i];
+            if (line.empty()) out += '0';
+            for (unsigned int j = 0; j < line.size(); j++) {
+                if (j) out += ',';
+                out += std::to_string(line[j]);
+            }
+            out += '\n';
+        }
+    };
+    out += "width " + std::to_string(puzzle.width) + "\nheight " + std::to_string(puzzle.height) + "\n\nrows\n";
+    appendLines(puzzle.rows);
+    out += "\ncolumns\n";
+    appendLines(puzzle.columns);
+    out += '\n';
+}
@@ -0,0 +1,175 @@
+/*
+ * Puzzle.h
+ * Namespace pc: A picross puzzle, its dimensions plus the clues of every row
+ * and column, and a streaming reader for puzzle files.
+ *
+ * Two text formats are understood, and a stream may mix them:
+ *
+ * .non blocks, as used by most nonogram collections:
+ *
+ *   title "Duck"          (title, catalogue, by, goal, ... are skipped)
+ *   width 5
+ *   height 5
+ *   rows
+ *   2,2
+ *   ...one clue line per row...
+ *   columns
+ *   1 2
+ *   ...one clue line per column...
+ *
+ * Clue numbers are separated by commas or spaces and a line holding 0 is an
+ * empty row or column. Blank lines and lines starting with # are ignored.
+ *
+ * Compact lines, one puzzle per line, rows then columns:
+ *
+ *   2.2,1,1.2,1,4|1.2,1.1.1,1,1.1.1,3
+ *
+ * Lines are separated by commas and numbers within a line by dots; the
+ * height is the number of row clues and the width the number of columns.
+ *
+ * Clue numbers are stored in 16 bits, so no block may be longer than
+ * CLUE_MAX cells, and no puzzle may have more than CLUE_MAX rows or columns.
+ * Lines between .non blocks that are not keywords are skipped as metadata,
+ * up to the next compact puzzle.
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+namespace pc {
+    const unsigned int CLUE_MAX = 65535; // Longest block a clue can hold.
+
+    // The clues of one line; a view into a ClueList, valid until the list changes.
+    struct ClueLine {
+        const uint16_t* values;
+        unsigned int count;
+
+        inline const uint16_t* data() const { return this->values; }
+        inline const uint16_t* begin() const { return this->values; }
+        inline const uint16_t* end() const { return this->values + this->count; }
+        inline unsigned int size() const { return this->count; }
+        inline bool empty() const { return !this->count; }
+        inline unsigned int operator[](unsigned int i) const { return this->values[i]; }
+    };
+
+    /*
+     * The clues of every row, or every column, of a puzzle in two flat
+     * buffers: every clue number in line order, and the offset at which each
+     * line's numbers start. Clearing keeps both buffers, so reading puzzle
+     * after puzzle into one ClueList stops allocating once it has held the
+     * largest of them.
+     */
+    class ClueList {
+        public:
+            ClueList() : offsets(1, 0) {}
+
+            // No lines; addLine() and push() then build the list line by line.
+            inline void clear() {
+                this->offsets.assign(1, 0);
+                this->values.clear();
+            }
+            inline void addLine() { this->offsets.push_back(this->offsets.back()); }
+            // Appends a number to the last line; false, appending nothing, if it is above CLUE_MAX.
+            inline bool push(unsigned int value) {
+                if (value > CLUE_MAX) return false;
+                this->values.push_back(value);
+                this->offsets.back()++;
+                return true;
+            }
+            // lines empty lines.
+            void assign(unsigned int lines);
+            /*
+             * Replaces the numbers of one line, moving the lines after it.
+             * False, leaving the line as it was, if a number is above CLUE_MAX.
+             */
+            bool set(unsigned int line, const unsigned int* values, unsigned int count);
+            inline bool set(unsigned int line, std::initializer_list<unsigned int> values) {
+                return this->set(line, values.begin(), values.size());
+            }
+            inline bool set(unsigned int line, const std::vector<unsigned int>& values) {
+                return this->set(line, values.data(), values.size());
+            }
+
+            inline unsigned int size() const { return this->offsets.size() - 1; }
+            // Bytes held: four per line plus two per clue number.
+            inline size_t memoryUsage() const {
+                return this->offsets.capacity() * sizeof(uint32_t) + this->values.capacity() * sizeof(uint16_t);
+            }
+            inline ClueLine operator[](unsigned int line) const {
+                return {this->values.data() + this->offsets[line], this->offsets[line + 1] - this->offsets[line]};
+            }
+
+        private:
+            std::vector<uint32_t> offsets; // size() + 1 entries; the last is values.size().
+            std::vector<uint16_t> values;
+    };
+
+    struct Puzzle {
+        unsigned int width = 0, height = 0;
+        ClueList rows, columns;
+
+        // Sets the dimensions; every clue starts out empty. Clue storage from
+        // an earlier puzzle is kept for reuse.
+        void resize(unsigned int width, unsigned int height) {
+            this->width = width;
+            this->height = height;
+            this->rows.assign(height);
+            this->columns.assign(width);
+        }
+    };
+
+    /*
+     * Reads puzzles in a single pass: files are memory mapped, and pipes are
+     * read in large blocks. Numbers are parsed straight out of the buffer.
+     */
+    class PuzzleReader {
+        public:
+            PuzzleReader();
+            ~PuzzleReader();
+            PuzzleReader(const PuzzleReader&) = delete;
+            PuzzleReader& operator=(const PuzzleReader&) = delete;
+
+            // Opens a file, or standard input for "-". False if it cannot be read.
+            bool open(const char* filename);
+            // Reads from memory that must outlive the reader.
+            void open(const char* data, size_t size);
+            void close();
+
+            /*
+             * Reads the next puzzle. Returns false at the end of the input or
+             * on a malformed puzzle, in which case getError() says why.
+             */
+            bool next(Puzzle& puzzle);
+
+            inline const std::string& getError() const { return this->error; }
+            inline unsigned long long getLine() const { return this->lineNumber; }
+            inline unsigned long long getBytes() const { return this->consumed; }
+
+        private:
+            // Next line without its terminator, or false at the end of input.
+            bool nextLine(const char*& begin, const char*& end);
+            // Next line that is neither blank nor a comment.
+            bool nextContentLine(const char*& begin, const char*& end);
+            bool fail(const char* message);
+            bool readNon(Puzzle& puzzle, const char* begin, const char* end);
+            bool readCompact(Puzzle& puzzle, const char* begin, const char* end);
+
+            int fd;
+            const char* data;      // Mapped file or caller's memory.
+            size_t size, offset;
+            void* mapping;
+            std::vector<char> buffer; // Block buffer for streams.
+            size_t bufferStart, bufferEnd;
+            bool streamEnd;
+            unsigned long long lineNumber, consumed;
+            std::string error;
+    };
+
+    // Appends a puzzle as one compact line, including the newline.
+    void appendCompact(std::string& out, const Puzzle& puzzle);
+    // Appends a puzzle as a .non block followed by a blank line.
+    void appendNon(std::string& out, const Puzzle& puzzle);
+};
@@ -0,0 +1,165 @@
+#include "Probe.h"
+#include "Search.h"
+
+pc::Search::Search(Grid& picross, const ClueList& rows, const ClueList& columns, const SolveOptions& options,
+                   SolveStats& stats, SearchShared* shared, SolveScratch* scratch, SolveBudget* budget)
+    : picross(picross), rows(rows), columns(columns), options(options), stats(stats), scratch(scratch ? *scratch : own),
+      found(0), shared(shared), budget(shared ? shared->budget : budget)
+{
+    this->scratch.queue.reset(picross.getWidth(), picross.getHeight(), options.prioritize);
+}
+
+pc::Status pc::Search::run() {
+    this->found = 0;
+    this->picross.setTrailing(true);
+    this->node();
+    const bool stopped = !this->found && this->budget && this->budget->stopped();
+    // Back out of the guesses the budget stopped in.
+    if (stopped) this->picross.undo(0);
+    this->picross.setTrailing(false);
+    if (stopped) return STOPPED;
+    if (!this->found) return CONTRADICTION;
+    this->picross.copyFrom(this->scratch.solution);
+    return SOLVED;
+}
+
+void pc::Search::explore(int row, int column) {
+    this->picross.setTrailing(true);
+    if (row >= 0) {
+        this->scratch.queue.push(ROWS, row, 0);
+        this->scratch.queue.push(COLUMNS, column, 0);
+    }
+    this->node();
+}
+
+bool pc::Search::node() {
+    if (this->shared && this->shared->stop.load(std::memory_order_relaxed)) return true;
+    if (this->budget && this->budget->stopped()) {
+        if (this->shared) this->shared->stop = true;
+        return true;
+    }
+    this->stats.searchNodes++;
+    Status status = propagate(this->picross, this->rows, this->columns, this->scratch.queue, this->scratch.lineSolver,
+                              this->options, &this->stats, nullptr, this->budget);
+    if (status == STUCK && this->options.deduction == PROBING) {
+        status = probe(this->picross, this->rows, this->columns, this->scratch, this->options, &this->stats, this->budget);
+    }
+    if (status == STOPPED) {
+        if (this->shared) this->shared->stop = true;
+        return true;
+    }
+    if (status == CONTRADICTION) {
+        this->stats.backtracks++;
+        return false;
+    }
+    if (status == SOLVED && this->shared) {
+        std::lock_guard<std::mutex> lock(this->shared->mutex);
+        if (this->shared->stop) return true;
+        if (!this->shared->found++) this->shared->firstSolution.copyFrom(this->picross);
+        this->stats.solutions++;
+        bool stop = this->options.onSolution && !this->options.onSolution(this->picross);
+        stop = stop || (this->options.solutionLimit && this->shared->found >= this->options.solutionLimit);
+        if (stop) this->shared->stop = true;
+        return stop;
+    }
+    if (status == SOLVED) {
+        if (!this->found++) this->scratch.solution.copyFrom(this->picross);
+        this->stats.solutions++;
+        if (this->options.onSolution && !this->options.onSolution(this->picross)) return true;
+        return this->options.solutionLimit && this->found >= this->options.solutionLimit;
+    }
+
+    unsigned int row, column;
+    this->chooseCell(row, column);
+    const size_t mark = this->picross.trailSize();
+    if (this->shared && this->shared->pool.queued() < this->shared->pool.size()) {
+        // The pool is running dry: give it the crossed branch.
+        std::shared_ptr<Grid> branch = std::make_shared<Grid>();
+        branch->copyFrom(this->picross);
+        branch->set(row, column, CROSSED);
+        this->shared->spawn(branch, row, column);
+        this->picross.set(row, column, FILLED);
+        this->scratch.queue.push(ROWS, row, 0);
+        this->scratch.queue.push(COLUMNS, column, 0);
+        if (this->node()) return true;
+        this->picross.undo(mark);
+        return false;
+    }
+    for (uint8_t guess : {FILLED, CROSSED}) {
+        this->picross.set(row, column, guess);
+        // Priority 0 puts the guessed lines at the front of a priority queue.
+        this->scratch.queue.push(ROWS, row, 0);
+        this->scratch.queue.push(COLUMNS, column, 0);
+        if (this->node()) return true;
+        this->picross.undo(mark);
+    }
+    return false;
+}
+
+void pc::SearchShared::spawn(std::shared_ptr<Grid> grid, int row, int column) {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->tasks++;
+    }
+    this->pool.submit([this, grid, row, column]() {
+        SolveStats taskStats;
+        Search(*grid, this->rows, this->columns, this->options, taskStats, this).explore(row, column);
+        std::lock_guard<std::mutex> lock(this->mutex);
+        addStats(this->stats, taskStats);
+        if (!--this->tasks) this->done.notify_all();
+    });
+}
+
+void pc::SearchShared::wait() {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->done.wait(lock, [&]() { return !this->tasks; });
+}
+
+pc::Status pc::parallelSearch(Grid& picross, const ClueList& rows, const ClueList& columns, const SolveOptions& options,
+                              SolveStats& stats, SolveBudget* budget) {
+    std::unique_ptr<ThreadPool> ownPool;
+    if (!options.pool) ownPool.reset(new ThreadPool(options.threads));
+    SearchShared shared(options.pool ? *options.pool : *ownPool, rows, columns, options, budget);
+
+    // The root is already propagated, so it goes straight to branching.
+    std::shared_ptr<Grid> root = std::make_shared<Grid>();
+    root->copyFrom(picross);
+    shared.spawn(root, -1, -1);
+    shared.wait();
+
+    addStats(stats, shared.stats);
+    if (!shared.found && budget && budget->stopped()) return STOPPED;
+    if (!shared.found) return CONTRADICTION;
+    picross.copyFrom(shared.firstSolution);
+    return SOLVED;
+}
+
+bool pc::Search::chooseCell(unsigned int& row, unsigned int& column) const {
+    unsigned int bestUnknown = ~0u, bestLine = 0;
+    unsigned char bestCrs = ROWS;
+    for (unsigned char crs = COLUMNS; crs <= ROWS; crs++) {
+        const unsigned int length = this->picross.lineLength(crs);
+        for (unsigned int cr = 0; cr < this->picross.lineCount(crs); cr++) {
+            const unsigned int unknown = length - this->picross.countKnown(crs, cr);
+            if (unknown && unknown < bestUnknown) {
+                bestUnknown = unknown;
+                bestCrs = crs;
+                bestLine = cr;
+            }
+        }
+    }
+    if (bestUnknown == ~0u) return false;
+
+    const word* filled = this->picross.filled(bestCrs, bestLine);
+    const word* crossed = this->picross.crossed(bestCrs, bestLine);
+    const unsigned int length = this->picross.lineLength(bestCrs);
+    for (unsigned int w = 0; w < this->picross.lineWords(bestCrs); w++) {
+        const word unknown = ~(filled[w] | crossed[w]) & lineMask(length, w);
+        if (!unknown) continue;
+        const unsigned int i = w * WORD_BITS + __builtin_ctzll(unknown);
+        row = bestCrs ? bestLine : i;
+        column = bestCrs ? i : bestLine;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,100 @@
+/*
+ * Search.h
+ * Namespace pc: Backtracking search on top of line propagation.
+ *
+ * Each node propagates the grid to a fixed point, and probes it too with
+ * the PROBING deduction level. A contradiction ends the branch; otherwise
+ * the search picks an unknown cell in the line with the fewest unknown cells
+ * left, tries it filled and then crossed, and recurses.
+ * The grid keeps an undo trail, so leaving a branch only reverts the words
+ * that branch changed instead of restoring a copy of the whole grid.
+ *
+ * The parallel search runs the same nodes on a work-stealing pool. While the
+ * pool is short of work, a node hands its "crossed" branch to the pool as a
+ * task holding its own copy of the grid and explores the "filled" branch
+ * itself. Every worker checks one atomic flag, which is raised as soon as the
+ * solution limit is reached.
+ *
+ * Every node also checks the solve's budget, if it has one. A search it stops
+ * before any solution is found returns STOPPED with the grid as it was before
+ * the first guess.
+ */
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+#include "Grid.h"
+#include "LineQueue.h"
+#include "LineSolver.h"
+#include "Solver.h"
+#include "ThreadPool.h"
+
+namespace pc {
+    // State shared by every worker of one parallel search.
+    struct SearchShared {
+        SearchShared(ThreadPool& pool, const ClueList& rows, const ClueList& columns, const SolveOptions& options,
+                     SolveBudget* budget)
+            : pool(pool), rows(rows), columns(columns), options(options), budget(budget), stop(false), tasks(0), found(0) {}
+
+        // Hands the search below grid to the pool; a negative row means no
+        // guess was made, otherwise the guess at (row, column) is propagated.
+        void spawn(std::shared_ptr<Grid> grid, int row, int column);
+        // Waits for every spawned task of this search.
+        void wait();
+
+        ThreadPool& pool;
+        const ClueList& rows;
+        const ClueList& columns;
+        const SolveOptions& options;
+        SolveBudget* budget;
+        std::atomic<bool> stop;
+        // Guards everything below.
+        std::mutex mutex;
+        std::condition_variable done;
+        unsigned int tasks;
+        unsigned long long found;
+        Grid firstSolution;
+        SolveStats stats;
+    };
+
+    class Search {
+        public:
+            // Works in scratch if given, otherwise in buffers of its own.
+            Search(Grid& picross, const ClueList& rows, const ClueList& columns, const SolveOptions& options,
+                   SolveStats& stats, SearchShared* shared = nullptr, SolveScratch* scratch = nullptr,
+                   SolveBudget* budget = nullptr);
+
+            /*
+             * Searches from the current grid state, whose lines must already
+             * be propagated. Returns SOLVED with the first solution in the grid
+             * if there is one, STOPPED with the grid unchanged if the budget
+             * ran out first, CONTRADICTION otherwise.
+             */
+            Status run();
+
+            // Parallel task: searches below the grid after a guess at (row, column).
+            void explore(int row, int column);
+
+        private:
+            // Returns true once the search should stop.
+            bool node();
+            // Picks the cell to branch on; false if the grid is complete.
+            bool chooseCell(unsigned int& row, unsigned int& column) const;
+
+            Grid& picross;
+            const ClueList& rows;
+            const ClueList& columns;
+            const SolveOptions& options;
+            SolveStats& stats;
+            SolveScratch own;
+            SolveScratch& scratch;
+            unsigned long long found;
+            SearchShared* shared;
+            SolveBudget* budget;
+    };
+
+    // Same contract as Search::run(), spread over options.threads workers.
+    Status parallelSearch(Grid& picross, const ClueList& rows, const ClueList& columns, const SolveOptions& options,
+                          SolveStats& stats, SolveBudget* budget = nullptr);
+};
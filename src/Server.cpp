@@ -0,0 +1,322 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include "Batch.h"
+#include "Server.h"
+
+namespace {
+    const size_t BLOCK_SIZE = 1 << 16;
+
+    // Next run of non-blank characters at or after p; false if there is none.
+    bool nextToken(const char*& p, const char* end, const char*& begin, const char*& tokenEnd) {
+        while (p < end && (*p == ' ' || *p == '\t')) p++;
+        if (p == end) return false;
+        begin = p;
+        while (p < end && *p != ' ' && *p != '\t') p++;
+        tokenEnd = p;
+        return true;
+    }
+
+    // Parses a whole token as a decimal number.
+    bool parseNumber(const char* begin, const char* end, unsigned long long& value) {
+        if (begin == end || end - begin > 19) return false;
+        value = 0;
+        for (const char* p = begin; p < end; p++) {
+            if (*p < '0' || *p > '9') return false;
+            value = value * 10 + (*p - '0');
+        }
+        return true;
+    }
+
+    bool sendAll(int fd, bool socket, const char* data, size_t size) {
+        while (size) {
+            const ssize_t sent = socket ? send(fd, data, size, MSG_NOSIGNAL) : write(fd, data, size);
+            if (sent < 0 && errno == EINTR) continue;
+            if (sent <= 0) return false;
+            data += sent;
+            size -= sent;
+        }
+        return true;
+    }
+}
+
+// One solve request, shared by the task solving it and cancel.
+struct pc::Server::Request {
+    Connection* connection;
+    unsigned long long id;
+    Puzzle puzzle;
+    bool search;
+    Deduction deduction;
+    std::chrono::milliseconds timeLimit;
+    unsigned long long stepLimit;
+    std::atomic<bool> cancel{false};
+};
+
+struct pc::Server::Connection {
+    Connection(int out, bool socket) : out(out), socket(socket), failed(false) {}
+
+    // Writes one response; call with mutex held. After a failed write the
+    // client is gone, and later responses are dropped.
+    void send(const std::string& response) {
+        if (!this->failed) this->failed = !sendAll(this->out, this->socket, response.data(), response.size());
+    }
+
+    const int out;
+    const bool socket;
+    // Used by the reading thread only.
+    PuzzleReader reader;
+    // Guards everything below, and writes to out.
+    std::mutex mutex;
+    std::condition_variable answered;
+    // Every request object of the connection, at most window of them. One
+    // goes back to idle once it is answered, so its clue storage is reused
+    // and a warm connection allocates nothing per request.
+    std::vector<std::unique_ptr<Request>> requests;
+    std::vector<Request*> idle;
+    // Requests read but not answered yet, for the window, cancel and
+    // repeated ids.
+    std::vector<Request*> running;
+    bool failed;
+};
+
+pc::Server::Server(const ServerOptions& options)
+    : options(options), pool(options.threads), workspaces(this->pool.size()), clients(0)
+{
+    if (!this->options.window) this->options.window = 64 * this->pool.size();
+    for (auto& workspace : this->workspaces) {
+        workspace.options = options.solve;
+        workspace.options.threads = 1;
+        workspace.options.pool = nullptr;
+        workspace.options.parallelSweep = false;
+    }
+}
+
+pc::Server::~Server() {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->clientsDone.wait(lock, [&]() { return !this->clients; });
+}
+
+pc::ServerCounters pc::Server::getCounters() {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->counters;
+}
+
+bool pc::Server::serve(int in, int out) {
+    return this->serve(in, out, false);
+}
+
+bool pc::Server::serve(int in, int out, bool socket) {
+    Connection connection(out, socket);
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->counters.connections++;
+    }
+    std::vector<char> buffer(BLOCK_SIZE);
+    size_t start = 0, end = 0;
+    bool ok = true;
+    while (true) {
+        const char* newline = (const char*)memchr(buffer.data() + start, '\n', end - start);
+        if (newline) {
+            this->request(connection, buffer.data() + start, newline);
+            start = newline + 1 - buffer.data();
+            continue;
+        }
+        // Keep the partial line at the front, growing the buffer for long ones.
+        std::copy(buffer.begin() + start, buffer.begin() + end, buffer.begin());
+        end -= start;
+        start = 0;
+        if (end == buffer.size()) buffer.resize(2 * buffer.size());
+        const ssize_t got = read(in, buffer.data() + end, buffer.size() - end);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) {
+            ok = !got;
+            break;
+        }
+        end += got;
+    }
+    if (ok && end > start) this->request(connection, buffer.data() + start, buffer.data() + end);
+
+    std::unique_lock<std::mutex> lock(connection.mutex);
+    connection.answered.wait(lock, [&]() { return connection.running.empty(); });
+    return ok && !connection.failed;
+}
+
+void pc::Server::request(Connection& connection, const char* begin, const char* end) {
+    while (end > begin && (end[-1] == '\r' || end[-1] == ' ' || end[-1] == '\t')) end--;
+    const char* p = begin;
+    const char* token;
+    const char* tokenEnd;
+    if (!nextToken(p, end, token, tokenEnd) || *token == '#') return;
+
+    Request* request = nullptr;
+    std::string response;
+    auto fail = [&](const std::string& id, const std::string& message) {
+        response = id + " error " + message + "\n";
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->counters.requests++;
+            this->counters.errors++;
+        }
+        std::lock_guard<std::mutex> lock(connection.mutex);
+        if (request) connection.idle.push_back(request);
+        connection.send(response);
+    };
+
+    unsigned long long id;
+    if (std::string(token, tokenEnd) == "cancel") {
+        if (!nextToken(p, end, token, tokenEnd) || !parseNumber(token, tokenEnd, id)) return fail("-", "cancel needs a request id");
+        std::lock_guard<std::mutex> lock(connection.mutex);
+        for (Request* running : connection.running) {
+            if (running->id == id) running->cancel = true;
+        }
+        return;
+    }
+    if (!parseNumber(token, tokenEnd, id)) return fail("-", "expected a request id");
+    const std::string name(token, tokenEnd);
+
+    {
+        // Stay within the window; a request object is then free or may be added.
+        std::unique_lock<std::mutex> lock(connection.mutex);
+        connection.answered.wait(lock, [&]() { return connection.running.size() < this->options.window; });
+        if (connection.idle.empty()) {
+            connection.requests.emplace_back(new Request());
+            connection.idle.push_back(connection.requests.back().get());
+        }
+        request = connection.idle.back();
+        connection.idle.pop_back();
+    }
+    request->connection = &connection;
+    request->id = id;
+    request->search = this->options.solve.search;
+    request->deduction = this->options.solve.deduction;
+    request->timeLimit = this->options.timeLimit;
+    request->stepLimit = this->options.solve.stepLimit;
+    request->cancel = false;
+    // Every token but the last is an option.
+    const char* puzzle = nullptr;
+    const char* puzzleEnd = nullptr;
+    while (nextToken(p, end, token, tokenEnd)) {
+        if (puzzle) {
+            const std::string option(puzzle, puzzleEnd);
+            unsigned long long value;
+            if (option == "search") request->search = true;
+            else if (option == "probe") request->deduction = PROBING;
+            else if (!option.compare(0, 5, "time=") && parseNumber(puzzle + 5, puzzleEnd, value)) {
+                request->timeLimit = std::chrono::milliseconds(value);
+            }
+            else if (!option.compare(0, 6, "steps=") && parseNumber(puzzle + 6, puzzleEnd, value)) {
+                request->stepLimit = value;
+            }
+            else return fail(name, "unknown option " + option);
+        }
+        puzzle = token;
+        puzzleEnd = tokenEnd;
+    }
+    if (!puzzle) return fail(name, "missing puzzle");
+    if (*puzzle < '0' || *puzzle > '9') return fail(name, "expected a compact puzzle");
+    connection.reader.open(puzzle, puzzleEnd - puzzle);
+    if (!connection.reader.next(request->puzzle)) {
+        // Drop the reader's "line N: ", which means nothing here.
+        const std::string& error = connection.reader.getError();
+        const size_t colon = error.find(": ");
+        return fail(name, colon == std::string::npos ? error : error.substr(colon + 2));
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(connection.mutex);
+        for (Request* running : connection.running) {
+            if (running->id != id) continue;
+            lock.unlock();
+            return fail(name, "request already running");
+        }
+        connection.running.push_back(request);
+    }
+    // Two pointers fit in the task's own storage: no allocation per request.
+    this->pool.submit([this, request]() { this->answer(*request); });
+}
+
+void pc::Server::answer(Request& request) {
+    Connection& connection = *request.connection;
+    Workspace& workspace = this->workspaces[this->pool.currentWorker()];
+    SolveOptions& options = workspace.options;
+    options.search = request.search;
+    options.deduction = request.deduction;
+    options.stepLimit = request.stepLimit;
+    options.deadline = request.timeLimit.count() ? std::chrono::steady_clock::now() + request.timeLimit
+                                                 : std::chrono::steady_clock::time_point::max();
+    options.cancel = &request.cancel;
+    workspace.grid.resize(request.puzzle.width, request.puzzle.height);
+    const Status status = workspace.solver.solve(workspace.grid, request.puzzle, options);
+    options.cancel = nullptr;
+
+    // Cleared rather than assigned, so the response keeps its buffer.
+    workspace.response.clear();
+    workspace.response += std::to_string(request.id);
+    workspace.response += ' ';
+    workspace.response += statusName(status);
+    workspace.response += ' ';
+    appendGrid(workspace.response, workspace.grid);
+    workspace.response += '\n';
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->counters.requests++;
+        if (status == STOPPED) this->counters.stopped++;
+    }
+    std::lock_guard<std::mutex> lock(connection.mutex);
+    connection.send(workspace.response);
+    *std::find(connection.running.begin(), connection.running.end(), &request) = connection.running.back();
+    connection.running.pop_back();
+    connection.idle.push_back(&request);
+    connection.answered.notify_all();
+}
+
+bool pc::Server::listen(const std::string& path) {
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        this->error = "socket path too long: " + path;
+        return false;
+    }
+    memcpy(address.sun_path, path.c_str(), path.size());
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        this->error = std::string("could not create a socket: ") + strerror(errno);
+        return false;
+    }
+    unlink(path.c_str());
+    if (bind(fd, (const sockaddr*)&address, sizeof(address)) || ::listen(fd, SOMAXCONN)) {
+        this->error = "could not listen on " + path + ": " + strerror(errno);
+        ::close(fd);
+        return false;
+    }
+    while (true) {
+        const int client = accept(fd, nullptr, nullptr);
+        if (client < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->error = std::string("could not accept a connection: ") + strerror(errno);
+            break;
+        }
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->clients++;
+        }
+        std::thread([this, client]() {
+            this->serve(client, client, true);
+            ::close(client);
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->clients--;
+            this->clientsDone.notify_all();
+        }).detach();
+    }
+    ::close(fd);
+    return false;
+}
@@ -0,0 +1,113 @@
+/*
+ * Server.h
+ * Namespace pc: Solves puzzles sent as requests over a stream, for clients
+ * that would otherwise start a process per puzzle.
+ *
+ * A server keeps one thread pool, one Solver and Grid per worker, and the
+ * line cache and placement table of its options for as long as it runs, so a
+ * request pays for neither process startup nor cold state. Requests and
+ * responses are lines of text:
+ *
+ *   <id> [search] [probe] [time=<ms>] [steps=<n>] <puzzle>
+ *   cancel <id>
+ *
+ * where id is a number chosen by the client and puzzle is a compact line
+ * (see Puzzle.h). search, probe, time and steps override the server's
+ * defaults for that request; cancel stops a request that is still being
+ * solved. Every request gets exactly one response:
+ *
+ *   <id> <status> <row>/<row>/...
+ *   <id> error <message>
+ *
+ * in the grid format of Batch.h, with "-" for the id of a line too malformed
+ * to have one. A client may send any number of requests without waiting.
+ * They are solved concurrently and answered as each finishes, so responses
+ * come back in any order and the id says which request each one answers. A
+ * cancelled request answers "stopped" with the cells proven so far; cancel
+ * itself has no response.
+ *
+ * Each connection reads at most a window of requests ahead of their
+ * responses. Responses are written by the worker that solved the request,
+ * so a client that stops reading holds up those workers.
+ */
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Grid.h"
+#include "Solver.h"
+#include "ThreadPool.h"
+
+namespace pc {
+    struct ServerOptions {
+        unsigned int threads = 1;
+        // Defaults for every request. Each request is solved on a single thread.
+        SolveOptions solve;
+        // Time each request may take before it is stopped; 0 for no limit.
+        std::chrono::milliseconds timeLimit = std::chrono::milliseconds(0);
+        // Requests a connection may have unanswered before reading waits; 0 for 64 per thread.
+        unsigned int window = 0;
+    };
+
+    struct ServerCounters {
+        unsigned long long connections = 0;
+        unsigned long long requests = 0;
+        unsigned long long errors = 0;
+        unsigned long long stopped = 0;
+    };
+
+    class Server {
+        public:
+            explicit Server(const ServerOptions& options);
+            ~Server();
+            Server(const Server&) = delete;
+            Server& operator=(const Server&) = delete;
+
+            /*
+             * Serves one client: reads requests from in until the end of its
+             * input and writes the responses to out, returning once every
+             * response is written. False if reading or writing failed.
+             * Several clients may be served at once from different threads.
+             */
+            bool serve(int in, int out);
+            /*
+             * Listens on a Unix domain socket at path, replacing any socket
+             * left there, and serves every client that connects on a thread
+             * of its own. Only returns if accepting connections fails.
+             */
+            bool listen(const std::string& path);
+
+            ServerCounters getCounters();
+            inline const std::string& getError() const { return this->error; }
+
+        private:
+            struct Connection;
+            struct Request;
+            // Per-worker state, reused for every request that worker solves.
+            struct Workspace {
+                Solver solver;
+                SolveOptions options;
+                Grid grid;
+                std::string response;
+            };
+
+            bool serve(int in, int out, bool socket);
+            // Handles one request line, without its terminator.
+            void request(Connection& connection, const char* begin, const char* end);
+            // Solves a request on a worker and writes its response.
+            void answer(Request& request);
+
+            ServerOptions options;
+            ThreadPool pool;
+            std::vector<Workspace> workspaces;
+            // Guards counters, clients and error.
+            std::mutex mutex;
+            std::condition_variable clientsDone;
+            ServerCounters counters;
+            // Clients of listen() still being served.
+            unsigned int clients;
+            std::string error;
+    };
+};
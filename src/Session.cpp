@@ -0,0 +1,117 @@
+#include <algorithm>
+#include "Search.h"
+#include "Session.h"
+
+void pc::LineLog::clear() {
+    this->entries.clear();
+    this->masks.clear();
+}
+
+void pc::LineLog::record(const Grid& picross, unsigned char crs, unsigned int cr, const word* changed) {
+    const unsigned int words = picross.lineWords(crs);
+    const word* filled = picross.filled(crs, cr);
+    const word* crossed = picross.crossed(crs, cr);
+    this->entries.push_back({crs, cr, this->masks.size()});
+    for (unsigned int w = 0; w < words; w++) this->masks.push_back((filled[w] | crossed[w]) & ~changed[w]);
+    this->masks.insert(this->masks.end(), changed, changed + words);
+}
+
+void pc::LineLog::invalidate(unsigned char crs, unsigned int cr, Grid& forgotten) {
+    // Entries that survive are compacted towards the front, in order.
+    size_t keptEntries = 0, keptMasks = 0;
+    for (size_t e = 0; e < this->entries.size(); e++) {
+        const Entry entry = this->entries[e];
+        const unsigned int words = forgotten.lineWords(entry.crs);
+        const word* known = &this->masks[entry.offset];
+        const word* changed = known + words;
+        bool stale = entry.crs == crs && entry.cr == cr;
+        const word* lost = forgotten.filled(entry.crs, entry.cr);
+        for (unsigned int w = 0; w < words && !stale; w++) stale = known[w] & lost[w];
+        if (stale) {
+            this->empty.assign(words, 0);
+            forgotten.merge(entry.crs, entry.cr, changed, &this->empty[0]);
+            continue;
+        }
+        if (keptMasks != entry.offset) std::copy(known, changed + words, &this->masks[keptMasks]);
+        this->entries[keptEntries++] = {entry.crs, entry.cr, keptMasks};
+        keptMasks += 2 * words;
+    }
+    this->entries.resize(keptEntries);
+    this->masks.resize(keptMasks);
+}
+
+pc::SolveSession::SolveSession(const Puzzle& puzzle, const SolveOptions& options)
+    : puzzle(puzzle), options(options), grid(puzzle.width, puzzle.height), forgotten(puzzle.width, puzzle.height),
+      status(STUCK), searchStatus(STUCK), full(true), searched(false)
+{
+    this->options.threads = 1;
+    this->options.pool = nullptr;
+    this->options.parallelSweep = false;
+    this->options.deduction = LINE_LOGIC;
+    this->scratch.queue.reset(puzzle.width, puzzle.height, false);
+}
+
+bool pc::SolveSession::setRowClue(unsigned int row, const std::vector<unsigned int>& clues) {
+    return row < this->puzzle.height && this->setClue(ROWS, row, clues);
+}
+
+bool pc::SolveSession::setColumnClue(unsigned int column, const std::vector<unsigned int>& clues) {
+    return column < this->puzzle.width && this->setClue(COLUMNS, column, clues);
+}
+
+bool pc::SolveSession::setClue(unsigned char crs, unsigned int cr, const std::vector<unsigned int>& clues) {
+    ClueList& lines = crs ? this->puzzle.rows : this->puzzle.columns;
+    const ClueLine current = lines[cr];
+    if (std::equal(current.begin(), current.end(), clues.begin(), clues.end())) return true;
+    if (!lines.set(cr, clues)) return false;
+
+    this->forgotten.clear();
+    this->log.invalidate(crs, cr, this->forgotten);
+    this->scratch.queue.push(crs, cr);
+    unsigned int lost = 0, known = 0;
+    for (unsigned int row = 0; row < this->grid.getHeight(); row++) {
+        lost += this->forgotten.countFilled(ROWS, row);
+        known += this->grid.countKnown(ROWS, row);
+    }
+    if (2 * lost > known) {
+        // Most of the grid depended on the line: starting over is cheaper.
+        this->grid.clear();
+        this->log.clear();
+        this->full = true;
+        return true;
+    }
+    // Forget the cells in the grid and requeue every line that lost one.
+    for (unsigned char lines = COLUMNS; lines <= ROWS; lines++) {
+        for (unsigned int line = 0; line < this->grid.lineCount(lines); line++) {
+            const word* cells = this->forgotten.filled(lines, line);
+            bool any = false;
+            for (unsigned int w = 0; w < this->grid.lineWords(lines) && !any; w++) any = cells[w];
+            if (!any) continue;
+            if (lines == ROWS) this->grid.forget(ROWS, line, cells);
+            this->scratch.queue.push(lines, line);
+        }
+    }
+    return true;
+}
+
+pc::Status pc::SolveSession::solve(SolveStats* stats) {
+    if (this->full) {
+        for (unsigned char crs = COLUMNS; crs <= ROWS; crs++) {
+            for (unsigned int cr = 0; cr < this->grid.lineCount(crs); cr++) this->scratch.queue.push(crs, cr);
+        }
+        this->full = false;
+    }
+    SolveBudget limits(this->options);
+    SolveBudget* budget = SolveBudget::needed(this->options) ? &limits : nullptr;
+    this->status = propagate(this->grid, this->puzzle.rows, this->puzzle.columns, this->scratch.queue,
+                             this->scratch.lineSolver, this->options, stats, &this->log, budget);
+    if (this->status == CONTRADICTION) this->full = true;
+
+    this->searched = this->options.search && this->status == STUCK;
+    if (!this->searched) return this->status;
+    SolveStats localStats;
+    this->solution.copyFrom(this->grid);
+    this->searchStatus = Search(this->solution, this->puzzle.rows, this->puzzle.columns, this->options,
+                                stats ? *stats : localStats, nullptr, &this->scratch, budget).run();
+    return this->searchStatus;
+}
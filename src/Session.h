@@ -0,0 +1,101 @@
+/*
+ * Session.h
+ * Namespace pc: Solver state kept across clue edits, for editors.
+ *
+ * A session holds a puzzle and the grid line logic has deduced for it. The
+ * first solve() propagates from an empty grid. After that, setRowClue() and
+ * setColumnClue() only forget the cells whose deduction depended on the
+ * edited line, and the next solve() propagates from what is left, so an edit
+ * costs about as much as the part of the grid it affects.
+ *
+ * Dependencies come from a log of every line solve that changed cells: which
+ * cells of the line were known when it was solved, and which it deduced. A
+ * solve of the edited line, or one that read a forgotten cell, is no longer
+ * valid, and the cells it deduced are forgotten in turn. Everything else was
+ * deduced from unchanged clues and cells that are still valid, so it is part
+ * of the new puzzle's line logic result too: propagating the rest of the way
+ * ends at the same grid a cold solve of the edited puzzle would.
+ */
+#pragma once
+#include <vector>
+#include "Grid.h"
+#include "LineQueue.h"
+#include "LineSolver.h"
+#include "Puzzle.h"
+#include "Solver.h"
+
+namespace pc {
+    /*
+     * Every line solve that changed cells, in order: the line, the cells of it
+     * known afterwards that it did not change (a superset of what the solve
+     * read) and the cells it changed.
+     */
+    class LineLog {
+        public:
+            void clear();
+            void record(const Grid& picross, unsigned char crs, unsigned int cr, const word* changed);
+
+            /*
+             * Drops every entry that solved line (crs, cr) or read a cell in
+             * forgotten, adding the cells those entries changed to forgotten as
+             * it goes. forgotten marks cells as filled; it must start empty or
+             * hold only cells already cleared from the grid.
+             */
+            void invalidate(unsigned char crs, unsigned int cr, Grid& forgotten);
+
+            inline size_t size() const { return this->entries.size(); }
+
+        private:
+            struct Entry {
+                unsigned char crs;
+                unsigned int cr;
+                size_t offset; // Into masks: the known words, then the changed words.
+            };
+
+            std::vector<Entry> entries;
+            std::vector<word> masks;
+            std::vector<word> empty;
+    };
+
+    class SolveSession {
+        public:
+            // Only options.search, the options it uses and the limits apply; the search is single-threaded.
+            explicit SolveSession(const Puzzle& puzzle, const SolveOptions& options = SolveOptions());
+
+            // Replace the clues of one line. False, changing nothing, for a line out of range or a number above CLUE_MAX.
+            bool setRowClue(unsigned int row, const std::vector<unsigned int>& clues);
+            bool setColumnClue(unsigned int column, const std::vector<unsigned int>& clues);
+
+            /*
+             * Brings the grid up to date with the clues. With options.search, a
+             * stuck grid is searched into a separate solution grid; the
+             * propagated grid is kept for the next edit. The options' limits
+             * apply to each call; one that returns STOPPED leaves the rest of
+             * the propagation queued, and the next call carries on with it.
+             */
+            Status solve(SolveStats* stats = nullptr);
+            // The deadline is a point in time, so a session needs a new one for each solve().
+            inline void setDeadline(std::chrono::steady_clock::time_point deadline) { this->options.deadline = deadline; }
+
+            inline const Puzzle& getPuzzle() const { return this->puzzle; }
+            // The solution if the last solve() searched, otherwise the propagated grid.
+            inline const Grid& getGrid() const { return this->searched ? this->solution : this->grid; }
+            // What the last solve() returned: the search's result if it searched.
+            inline Status getStatus() const { return this->searched ? this->searchStatus : this->status; }
+
+        private:
+            bool setClue(unsigned char crs, unsigned int cr, const std::vector<unsigned int>& clues);
+
+            Puzzle puzzle;
+            SolveOptions options;
+            Grid grid, solution, forgotten;
+            LineLog log;
+            SolveScratch scratch; // Its queue holds the lines left to propagate between solves.
+            Status status; // Of the propagation alone.
+            Status searchStatus;
+            // Queue every line on the next solve: the first one, and any after
+            // a contradiction, which leaves the queue unfinished.
+            bool full;
+            bool searched;
+    };
+};
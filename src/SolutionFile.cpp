@@ -0,0 +1,455 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "SolutionFile.h"
+
+namespace {
+    /*
+     * Header: the magic and the version as a 32-bit word. The index starts
+     * with the magic too: read as a record its flags byte would be 'C', which
+     * is no encoding, so walking the records of a file stops there. Trailer:
+     * the index offset and the record count as 64-bit words, then the magic.
+     */
+    const char MAGIC[8] = {'P', 'C', 'S', 'O', 'L', 'V', 'E', 'D'};
+    const uint32_t VERSION = 1;
+    const size_t HEADER_BYTES = sizeof(MAGIC) + 4, TRAILER_BYTES = 16 + sizeof(MAGIC);
+
+    void putVarint(std::string& out, uint64_t value) {
+        while (value >= 0x80) {
+            out += char(value | 0x80);
+            value >>= 7;
+        }
+        out += char(value);
+    }
+
+    // Reads a varint at data[at, end); false if it runs past end or over 64 bits.
+    bool getVarint(const uint8_t* data, size_t end, size_t& at, uint64_t& value) {
+        value = 0;
+        for (unsigned int shift = 0; at < end && shift < 64; shift += 7) {
+            const uint8_t byte = data[at++];
+            value |= uint64_t(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) return true;
+        }
+        return false;
+    }
+
+    void putWord(std::string& out, uint64_t value) {
+        for (unsigned int b = 0; b < 8; b++) out += char(value >> (8 * b));
+    }
+
+    uint64_t getWord(const uint8_t* data) {
+        uint64_t value = 0;
+        for (unsigned int b = 0; b < 8; b++) value |= uint64_t(data[b]) << (8 * b);
+        return value;
+    }
+
+    // Packs bits least significant first into whole bytes.
+    struct BitWriter {
+        std::string& out;
+        uint64_t pending = 0;
+        unsigned int bits = 0;
+
+        explicit BitWriter(std::string& out) : out(out) {}
+
+        // Appends the low count bits of value, which must be clear above them.
+        void put(uint64_t value, unsigned int count) {
+            pending |= value << bits;
+            if (bits + count < 64) {
+                bits += count;
+                return;
+            }
+            putWord(out, pending);
+            pending = bits ? value >> (64 - bits) : 0;
+            bits = bits + count - 64;
+        }
+
+        void finish() {
+            for (; bits > 0; bits = bits > 8 ? bits - 8 : 0, pending >>= 8) out += char(pending);
+        }
+    };
+
+    // Reads bits least significant first from bit start of data on.
+    struct BitReader {
+        const uint8_t* data;
+        uint64_t at;
+
+        // The next count (at most 64) bits.
+        uint64_t get(unsigned int count) {
+            uint64_t value = 0;
+            for (unsigned int done = 0; done < count;) {
+                const unsigned int shift = at % 8, take = std::min(8 - shift, count - done);
+                value |= uint64_t((data[at / 8] >> shift) & ((1u << take) - 1)) << done;
+                done += take;
+                at += take;
+            }
+            return value;
+        }
+    };
+
+    void putPlane(BitWriter& bits, const pc::Grid& picross, bool filled) {
+        const unsigned int width = picross.getWidth(), words = picross.lineWords(pc::ROWS);
+        for (unsigned int row = 0; row < picross.getHeight(); row++) {
+            const pc::word* line = filled ? picross.filled(pc::ROWS, row) : picross.crossed(pc::ROWS, row);
+            for (unsigned int w = 0; w < words; w++) {
+                bits.put(line[w] & pc::lineMask(width, w), std::min(pc::WORD_BITS, width - w * pc::WORD_BITS));
+            }
+        }
+    }
+
+    size_t varintBytes(uint64_t value) {
+        size_t bytes = 1;
+        for (; value >= 0x80; value >>= 7) bytes++;
+        return bytes;
+    }
+
+    /*
+     * Bytes of the runs of a solved grid, counting no further than limit.
+     * Appends them to out as well, if given.
+     */
+    size_t putRuns(std::string* out, const pc::Grid& picross, size_t limit) {
+        const unsigned int width = picross.getWidth();
+        size_t bytes = 0;
+        for (unsigned int row = 0; row < picross.getHeight() && bytes < limit; row++) {
+            const pc::word* filled = picross.filled(pc::ROWS, row);
+            bool set = false;
+            for (unsigned int at = 0, next; at < width; at = next, set = !set) {
+                next = pc::findBit(filled, width, at, !set);
+                bytes += varintBytes(next - at);
+                if (out) putVarint(*out, next - at);
+            }
+        }
+        return bytes;
+    }
+
+    /*
+     * True if data[at, end) holds exactly height rows of runs adding up to
+     * width each. A few bytes of varints can claim a huge width, so this is
+     * checked before the grid is allocated.
+     */
+    bool runsFit(const uint8_t* data, size_t at, size_t end, uint64_t width, uint64_t height) {
+        if (!width) return at == end; // Rows of no cells take no runs.
+        for (uint64_t row = 0; row < height; row++) {
+            for (uint64_t cell = 0, run; cell < width; cell += run) {
+                if (!getVarint(data, end, at, run) || run > width - cell) return false;
+            }
+        }
+        return at == end;
+    }
+}
+
+void pc::appendSolutionRecord(std::string& out, unsigned long long id, Status status, const Grid& picross) {
+    const unsigned int width = picross.getWidth(), height = picross.getHeight();
+    const size_t plane = (uint64_t(width) * height + 7) / 8;
+    putVarint(out, id);
+    const size_t flags = out.size();
+    out += char(0);
+    putVarint(out, width);
+    putVarint(out, height);
+
+    // A solved grid takes the runs if they are shorter than its plane.
+    SolutionEncoding encoding = status == SOLVED ? FILLED_PLANE : BOTH_PLANES;
+    const size_t runs = status == SOLVED ? putRuns(nullptr, picross, plane) : plane;
+    if (runs < plane) {
+        encoding = RUNS;
+        putVarint(out, runs);
+        putRuns(&out, picross, runs);
+    }
+    else {
+        putVarint(out, encoding == BOTH_PLANES ? (uint64_t(width) * height * 2 + 7) / 8 : plane);
+        BitWriter bits(out);
+        putPlane(bits, picross, true);
+        if (encoding == BOTH_PLANES) putPlane(bits, picross, false);
+        bits.finish();
+    }
+    out[flags] = char(status | (encoding << 2));
+}
+
+size_t pc::decodeSolutionRecord(const uint8_t* data, size_t size, unsigned long long& id, Status& status, Grid& picross) {
+    size_t at = 0;
+    uint64_t value, width, height, payload;
+    if (!getVarint(data, size, at, value) || at == size) return 0;
+    id = value;
+    const unsigned int flags = data[at++];
+    if (!getVarint(data, size, at, width) || !getVarint(data, size, at, height) || !getVarint(data, size, at, payload)) return 0;
+    if ((flags >> 2) > RUNS || width > UINT32_MAX || height > UINT32_MAX || payload > size - at) return 0;
+    status = Status(flags & 3);
+    const SolutionEncoding encoding = SolutionEncoding(flags >> 2);
+    const size_t end = at + payload;
+
+    // Check the payload can hold the grid before allocating it.
+    const uint64_t cells = width * height;
+    if (encoding == RUNS ? !runsFit(data, at, end, width, height) : payload != ((encoding == BOTH_PLANES ? 2 : 1) * cells + 7) / 8) return 0;
+
+    picross.resize(width, height);
+    const unsigned int words = picross.lineWords(ROWS);
+    std::vector<word> filled(words), crossed(words);
+    if (encoding == RUNS) {
+        for (unsigned int row = 0; row < height; row++) {
+            std::fill(filled.begin(), filled.end(), 0);
+            bool set = false;
+            for (uint64_t cell = 0, run; cell < width; cell += run, set = !set) {
+                if (!getVarint(data, end, at, run) || run > width - cell) return 0;
+                if (set) setRange(filled.data(), cell, cell + run);
+            }
+            for (unsigned int w = 0; w < words; w++) crossed[w] = ~filled[w] & lineMask(width, w);
+            picross.merge(ROWS, row, filled.data(), crossed.data());
+        }
+        return at == end ? end : 0;
+    }
+    BitReader filledBits{data + at, 0}, crossedBits{data + at, cells};
+    for (unsigned int row = 0; row < height; row++) {
+        for (unsigned int w = 0; w < words; w++) {
+            const unsigned int count = std::min(WORD_BITS, unsigned(width) - w * WORD_BITS);
+            filled[w] = filledBits.get(count);
+            crossed[w] = encoding == BOTH_PLANES ? crossedBits.get(count) & ~filled[w] : ~filled[w] & lineMask(width, w);
+        }
+        picross.merge(ROWS, row, filled.data(), crossed.data());
+    }
+    return end;
+}
+
+pc::SolutionWriter::SolutionWriter()
+    : stopping(false), fileOffset(0), fileRecords(0), failed(false) {}
+
+pc::SolutionWriter::~SolutionWriter() {
+    this->close();
+}
+
+bool pc::SolutionWriter::open(const std::string& path, const SolutionWriterOptions& options) {
+    this->close();
+    this->options = options;
+    this->options.queueRecords = std::max(1u, options.queueRecords);
+    this->path = path;
+    this->counters = SolutionWriterCounters();
+    this->failed = false;
+    this->error.clear();
+    this->stopping = false;
+    if (!this->startFile()) return false;
+    this->thread = std::thread(&SolutionWriter::run, this);
+    return true;
+}
+
+void pc::SolutionWriter::write(std::string& record) {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    if (this->queue.size() >= this->options.queueRecords) {
+        this->counters.stalls++;
+        this->space.wait(lock, [&]() { return this->queue.size() < this->options.queueRecords; });
+    }
+    this->queue.emplace_back();
+    this->queue.back().swap(record);
+    if (!this->spare.empty()) {
+        record.swap(this->spare.back());
+        this->spare.pop_back();
+    }
+    this->ready.notify_one();
+}
+
+bool pc::SolutionWriter::close() {
+    if (!this->thread.joinable()) return !this->failed;
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopping = true;
+        this->ready.notify_one();
+    }
+    this->thread.join();
+    if (!this->finishFile()) this->failed = true;
+    std::vector<std::string>().swap(this->spare);
+    return !this->failed;
+}
+
+void pc::SolutionWriter::run() {
+    std::vector<std::string> batch;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            // Hand the records written last time back for reuse.
+            for (std::string& record : batch) {
+                record.clear();
+                this->spare.push_back(std::move(record));
+            }
+            batch.clear();
+            this->ready.wait(lock, [&]() { return this->stopping || !this->queue.empty(); });
+            if (this->queue.empty()) return;
+            // Take the whole queue, so the disk is written without the lock held.
+            while (!this->queue.empty()) {
+                batch.push_back(std::move(this->queue.front()));
+                this->queue.pop_front();
+            }
+            this->space.notify_all();
+        }
+        for (const std::string& record : batch) {
+            if (this->options.recordsPerFile && this->fileRecords == this->options.recordsPerFile) {
+                if (!this->finishFile() || !this->startFile()) this->failed = true;
+            }
+            // The id is the record's leading varint.
+            uint64_t id = 0;
+            size_t at = 0;
+            getVarint(reinterpret_cast<const uint8_t*>(record.data()), record.size(), at, id);
+            this->index.push_back(id);
+            this->index.push_back(this->fileOffset);
+            this->put(record.data(), record.size());
+            this->fileRecords++;
+            this->counters.records++;
+        }
+    }
+}
+
+bool pc::SolutionWriter::startFile() {
+    std::string name = this->path;
+    if (this->options.recordsPerFile) {
+        char suffix[16];
+        snprintf(suffix, sizeof(suffix), ".%04u", this->counters.files);
+        name += suffix;
+    }
+    this->file.open(name, std::ofstream::binary | std::ofstream::trunc);
+    if (!this->file.is_open()) {
+        this->failed = true;
+        this->error = "could not write " + name;
+        return false;
+    }
+    this->counters.files++;
+    this->fileOffset = 0;
+    this->fileRecords = 0;
+    this->index.clear();
+    std::string header(MAGIC, sizeof(MAGIC));
+    for (unsigned int b = 0; b < 4; b++) header += char(VERSION >> (8 * b));
+    this->put(header.data(), header.size());
+    return true;
+}
+
+bool pc::SolutionWriter::finishFile() {
+    if (!this->file.is_open()) return false;
+    // Sort the (id, offset) pairs by id.
+    std::vector<std::pair<uint64_t, uint64_t>> entries(this->fileRecords);
+    for (size_t e = 0; e < entries.size(); e++) entries[e] = {this->index[2 * e], this->index[2 * e + 1]};
+    std::sort(entries.begin(), entries.end());
+    std::string tail(MAGIC, sizeof(MAGIC));
+    const uint64_t indexOffset = this->fileOffset;
+    for (const auto& entry : entries) {
+        putWord(tail, entry.first);
+        putWord(tail, entry.second);
+    }
+    putWord(tail, indexOffset);
+    putWord(tail, this->fileRecords);
+    tail.append(MAGIC, sizeof(MAGIC));
+    this->put(tail.data(), tail.size());
+    this->file.close();
+    if (this->file.fail() && this->error.empty()) this->error = "could not finish writing " + this->path;
+    return !this->file.fail();
+}
+
+void pc::SolutionWriter::put(const char* data, size_t size) {
+    this->file.write(data, size);
+    this->fileOffset += size;
+    this->counters.bytes += size;
+    if (!this->file.good() && !this->failed) {
+        this->failed = true;
+        this->error = "could not write " + this->path;
+    }
+}
+
+pc::SolutionReader::SolutionReader() : data(nullptr), bytes(0), entries(nullptr), count(0), rebuilt(false),
+                                         mapping(nullptr) {}
+
+pc::SolutionReader::~SolutionReader() {
+    this->close();
+}
+
+void pc::SolutionReader::close() {
+    if (this->mapping) munmap(this->mapping, this->bytes);
+    this->mapping = nullptr;
+    this->data = nullptr;
+    this->bytes = 0;
+    this->entries = nullptr;
+    this->count = 0;
+    std::vector<uint64_t>().swap(this->recovered);
+    this->rebuilt = false;
+}
+
+bool pc::SolutionReader::fail(const std::string& message) {
+    this->close();
+    this->error = message;
+    return false;
+}
+
+bool pc::SolutionReader::open(const std::string& path) {
+    this->close();
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return this->fail("could not open " + path);
+    struct stat status;
+    void* mapped = MAP_FAILED;
+    if (!fstat(fd, &status) && size_t(status.st_size) >= HEADER_BYTES) {
+        mapped = mmap(nullptr, status.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (mapped == MAP_FAILED) return this->fail(path + " is not a solution file");
+    this->mapping = mapped;
+    this->bytes = status.st_size;
+    this->data = static_cast<const uint8_t*>(mapped);
+    uint32_t version = 0;
+    for (unsigned int b = 0; b < 4; b++) version |= uint32_t(this->data[sizeof(MAGIC) + b]) << (8 * b);
+    if (memcmp(this->data, MAGIC, sizeof(MAGIC)) || version != VERSION) {
+        return this->fail(path + " is not a solution file of this version");
+    }
+
+    if (this->bytes >= HEADER_BYTES + sizeof(MAGIC) + TRAILER_BYTES && !memcmp(this->data + this->bytes - sizeof(MAGIC), MAGIC, sizeof(MAGIC))) {
+        const uint64_t indexOffset = getWord(this->data + this->bytes - TRAILER_BYTES);
+        const uint64_t records = getWord(this->data + this->bytes - TRAILER_BYTES + 8);
+        if (indexOffset < HEADER_BYTES || indexOffset > this->bytes - TRAILER_BYTES - sizeof(MAGIC) ||
+            memcmp(this->data + indexOffset, MAGIC, sizeof(MAGIC)) ||
+            records != (this->bytes - TRAILER_BYTES - indexOffset - sizeof(MAGIC)) / 16 ||
+            this->bytes - TRAILER_BYTES - indexOffset - sizeof(MAGIC) != records * 16) {
+            return this->fail(path + " has a damaged index");
+        }
+        this->entries = this->data + indexOffset + sizeof(MAGIC);
+        this->count = records;
+        return true;
+    }
+
+    // No trailer: walk the records that made it to the file.
+    std::vector<std::pair<uint64_t, uint64_t>> found;
+    Grid picross;
+    for (size_t at = HEADER_BYTES; at < this->bytes;) {
+        unsigned long long id;
+        Status status;
+        const size_t length = decodeSolutionRecord(this->data + at, this->bytes - at, id, status, picross);
+        if (!length) break;
+        found.emplace_back(id, at);
+        at += length;
+    }
+    std::sort(found.begin(), found.end());
+    this->recovered.resize(2 * found.size());
+    for (size_t e = 0; e < found.size(); e++) {
+        this->recovered[2 * e] = found[e].first;
+        this->recovered[2 * e + 1] = found[e].second;
+    }
+    this->count = found.size();
+    this->rebuilt = true;
+    return true;
+}
+
+unsigned long long pc::SolutionReader::getId(size_t i) const {
+    return this->rebuilt ? this->recovered[2 * i] : getWord(this->entries + 16 * i);
+}
+
+bool pc::SolutionReader::read(size_t i, unsigned long long& id, Status& status, Grid& picross) const {
+    if (i >= this->count) return false;
+    const uint64_t offset = this->rebuilt ? this->recovered[2 * i + 1] : getWord(this->entries + 16 * i + 8);
+    if (offset < HEADER_BYTES || offset >= this->bytes) return false;
+    return decodeSolutionRecord(this->data + offset, this->bytes - offset, id, status, picross) != 0;
+}
+
+bool pc::SolutionReader::find(unsigned long long id, Status& status, Grid& picross) const {
+    size_t low = 0, high = this->count;
+    while (low < high) {
+        const size_t middle = (low + high) / 2;
+        if (this->getId(middle) < id) low = middle + 1;
+        else high = middle;
+    }
+    unsigned long long found;
+    return low < this->count && this->getId(low) == id && this->read(low, found, status, picross);
+}
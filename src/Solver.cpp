@@ -0,0 +1,311 @@
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include "FixedSolver.h"
+#include "Instrument.h"
+#include "LineCache.h"
+#include "LineKernel.h"
+#include "ParallelSweep.h"
+#include "PlacementTable.h"
+#include "Probe.h"
+#include "Search.h"
+#include "Session.h"
+#include "Solver.h"
+
+const char* pc::statusName(Status status) {
+    switch (status) {
+        case SOLVED: return "solved";
+        case STUCK: return "stuck";
+        case CONTRADICTION: return "contradiction";
+        case STOPPED: return "stopped";
+    }
+    return "unknown";
+}
+
+void pc::appendStatsJson(std::string& out, const SolveStats& stats) {
+    auto field = [&](const char* name, unsigned long long value) {
+        if (!out.empty() && out.back() != '{') out += ", ";
+        out += '"';
+        out += name;
+        out += "\": ";
+        out += std::to_string(value);
+    };
+    field("line_solves", stats.lineSolves);
+    field("lines_queued", stats.linesQueued);
+    field("cells_changed", stats.cellsChanged);
+    field("search_nodes", stats.searchNodes);
+    field("backtracks", stats.backtracks);
+    field("solutions", stats.solutions);
+    if (stats.cacheLookups) {
+        field("cache_lookups", stats.cacheLookups);
+        field("cache_hits", stats.cacheHits);
+    }
+    if (stats.probes) {
+        field("probes", stats.probes);
+        field("probe_cells", stats.probeCells);
+    }
+    if (!instrumented) return;
+    field("rounds", stats.rounds);
+    field("sweep_ns", stats.sweepNanos);
+    field("check_ns", stats.checkNanos);
+    field("search_ns", stats.searchNanos);
+    field("output_ns", stats.outputNanos);
+}
+
+pc::SolveBudget::SolveBudget(const SolveOptions& options)
+    : options(options), start(needed(options) ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point()),
+      steps(0), nextCheck(CHECK_STEPS), stop(false), nextProgress(start + options.progressInterval)
+{
+    if (options.stepLimit && options.stepLimit < CHECK_STEPS) this->nextCheck = options.stepLimit;
+}
+
+bool pc::SolveBudget::needed(const SolveOptions& options) {
+    return options.deadline != std::chrono::steady_clock::time_point::max() || options.stepLimit || options.cancel ||
+           options.onProgress;
+}
+
+void pc::SolveBudget::check(unsigned long long total, const Grid& picross) {
+    unsigned long long next = total + CHECK_STEPS;
+    if (this->options.stepLimit) {
+        if (total >= this->options.stepLimit) this->stop = true;
+        next = std::min(next, this->options.stepLimit);
+    }
+    this->nextCheck.store(next, std::memory_order_relaxed);
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (now >= this->options.deadline) this->stop = true;
+    if (!this->options.onProgress) return;
+    std::unique_lock<std::mutex> lock(this->progressMutex, std::try_to_lock);
+    if (!lock.owns_lock() || now < this->nextProgress) return;
+    this->nextProgress = now + this->options.progressInterval;
+    SolveProgress progress;
+    progress.lineSolves = total;
+    progress.knownCells = 0;
+    for (unsigned int row = 0; row < picross.getHeight(); row++) progress.knownCells += picross.countKnown(ROWS, row);
+    progress.cells = uint64_t(picross.getWidth()) * picross.getHeight();
+    progress.seconds = std::chrono::duration<double>(now - this->start).count();
+    this->options.onProgress(progress);
+}
+
+/*
+ * Queue priority of a line: cells still unknown plus the slack its clues
+ * leave, so nearly finished and tightly packed lines come out first.
+ */
+static unsigned int linePriority(const pc::Grid& picross, unsigned char crs, unsigned int cr, pc::ClueLine clues) {
+    const unsigned int length = picross.lineLength(crs);
+    unsigned int used = 0;
+    for (auto& clue : clues) {
+        if (clue) used += clue + (used ? 1 : 0);
+    }
+    const unsigned int slack = used < length ? length - used : 0;
+    return (length - picross.countKnown(crs, cr)) + slack;
+}
+
+/*
+ * Queues the lines crossing the changed cells of a line that was just merged.
+ */
+static void queueCrossings(const pc::Grid& picross, unsigned char crs, const pc::word* changed,
+                           const pc::ClueList& rows, const pc::ClueList& columns,
+                           pc::LineQueue& queue, const pc::SolveOptions& options, pc::SolveStats* stats) {
+    // Cell i of this line is cell cr of crossing line i.
+    const unsigned char other = !crs;
+    const pc::ClueList& otherClues = other ? rows : columns;
+    for (unsigned int w = 0; w < picross.lineWords(crs); w++) {
+        for (pc::word m = changed[w]; m; m &= m - 1) {
+            const unsigned int i = w * pc::WORD_BITS + __builtin_ctzll(m);
+            queue.push(other, i, options.prioritize ? linePriority(picross, other, i, otherClues[i]) : 0);
+            if (stats) stats->linesQueued++;
+        }
+    }
+}
+
+pc::Status pc::propagate(Grid& picross, const ClueList& rows, const ClueList& columns,
+                         LineQueue& queue, LineSolver& lineSolver, const SolveOptions& options, SolveStats* stats,
+                         LineLog* log, SolveBudget* budget) {
+    PC_COUNT(stats, rounds, 1);
+    // Lines that fit in a word go through the line kernel a pass at a time,
+    // or through options.placements one at a time when it covers them.
+    // Lines solved in the same pass see the grid from before it; the cells
+    // any of them changes requeue the crossing lines, so nothing is lost.
+    LineJob jobs[LINE_KERNEL_LANES_MAX];
+    unsigned char jobCrs[LINE_KERNEL_LANES_MAX];
+    unsigned int jobCr[LINE_KERNEL_LANES_MAX];
+    uint64_t jobHash[LINE_KERNEL_LANES_MAX];
+    const unsigned int lanes = lineKernelLanes();
+    LineCache* cache = options.lineCache;
+
+    // Merges a solved job into the grid; false on a contradiction.
+    auto apply = [&](LineJob& job, unsigned char crs, unsigned int cr) {
+        if (!job.solvable) return false;
+        word changed;
+        const unsigned int cells = picross.merge(crs, cr, &job.outFilled, &job.outCrossed, &changed);
+        if (!cells) return true;
+        if (stats) stats->cellsChanged += cells;
+        if (log) log->record(picross, crs, cr, &changed);
+        queueCrossings(picross, crs, &changed, rows, columns, queue, options, stats);
+        return true;
+    };
+
+    // Line solves not yet reported to the budget. Stopping waits for the
+    // jobs already taken off the queue, so none of them is lost.
+    unsigned int steps = 0;
+    bool stopping = false;
+    auto spent = [&]() {
+        if (!budget || steps < SolveBudget::CHECK_STEPS) return false;
+        stopping = budget->spend(steps, picross);
+        steps = 0;
+        return stopping;
+    };
+    // Reports the rest on the way out, so a search of many small
+    // propagations is counted too.
+    auto finish = [&](Status status) {
+        if (budget && steps) budget->spend(steps, picross);
+        return status;
+    };
+
+    unsigned char crs;
+    unsigned int cr;
+    for (;;) {
+        unsigned int count = 0;
+        while (count < lanes && !spent() && queue.pop(crs, cr)) {
+            const ClueLine clues = (crs ? rows : columns)[cr];
+            LineJob& job = jobs[count];
+            if (setLineJob(job, clues.data(), clues.size(), picross.lineLength(crs),
+                           picross.filled(crs, cr)[0], picross.crossed(crs, cr)[0])) {
+                if (options.placements && options.placements->solve(job)) {
+                    steps++;
+                    if (stats) stats->lineSolves++;
+                    if (apply(job, crs, cr)) continue;
+                    queue.clear();
+                    return finish(CONTRADICTION);
+                }
+                if (cache) {
+                    jobHash[count] = LineCache::hash(job);
+                    if (stats) stats->cacheLookups++;
+                    if (cache->lookup(job, jobHash[count])) {
+                        if (stats) stats->cacheHits++;
+                        if (apply(job, crs, cr)) continue;
+                        queue.clear();
+                        return finish(CONTRADICTION);
+                    }
+                }
+                jobCrs[count] = crs;
+                jobCr[count++] = cr;
+                continue;
+            }
+            const LineResult result = lineSolver.solve(picross, crs, cr, clues);
+            steps++;
+            if (stats) stats->lineSolves++;
+            if (result == LINE_CONTRADICTION) {
+                queue.clear();
+                return finish(CONTRADICTION);
+            }
+            if (result == LINE_UNCHANGED) continue;
+            if (stats) stats->cellsChanged += lineSolver.getChanged();
+            if (log) log->record(picross, crs, cr, lineSolver.getChangedMask());
+            queueCrossings(picross, crs, lineSolver.getChangedMask(), rows, columns, queue, options, stats);
+        }
+        if (!count) break;
+
+        solveLineJobs(jobs, count);
+        // Every job was solved, even the ones after a contradiction.
+        steps += count;
+        if (stats) stats->lineSolves += count;
+        for (unsigned int j = 0; j < count; j++) {
+            if (cache) cache->store(jobs[j], jobHash[j]);
+            if (!apply(jobs[j], jobCrs[j], jobCr[j])) {
+                queue.clear();
+                return finish(CONTRADICTION);
+            }
+        }
+        if (stopping) return finish(STOPPED);
+    }
+    if (stopping) return finish(STOPPED);
+    PC_PHASE(stats, checkNanos);
+    return finish(picross.isSolved() ? SOLVED : STUCK);
+}
+
+pc::Status pc::Solver::solve(Grid& picross, const ClueList& rows, const ClueList& columns,
+                             const SolveOptions& options, SolveStats* stats) {
+    SolveStats localStats;
+    if (!stats) stats = &localStats;
+    const bool threaded = options.threads > 1 || options.pool;
+    Status status;
+    SolveBudget limits(options);
+    SolveBudget* budget = SolveBudget::needed(options) ? &limits : nullptr;
+    if (!threaded && !options.lineCache && options.deduction == LINE_LOGIC && solveFixedSize(picross, rows, columns, options, *stats, budget, status)) {
+        return status;
+    }
+    std::unique_ptr<ThreadPool> ownPool;
+    SolveOptions poolOptions;
+    if (threaded && !options.pool && (options.parallelSweep || options.search)) {
+        // One pool serves both the sweep and the search of this solve.
+        ownPool.reset(new ThreadPool(options.threads));
+        poolOptions = options;
+        poolOptions.pool = ownPool.get();
+    }
+    const SolveOptions& solveOptions = ownPool ? poolOptions : options;
+
+    {
+        PC_PHASE(stats, sweepNanos);
+        this->scratch.queue.reset(picross.getWidth(), picross.getHeight(), options.prioritize);
+        if (solveOptions.parallelSweep && threaded) {
+            status = parallelPropagate(picross, rows, columns, *solveOptions.pool, stats, budget);
+        }
+        else {
+            // Every line has to be looked at once; after that only changes queue work.
+            for (unsigned char crs = COLUMNS; crs <= ROWS; crs++) {
+                const ClueList& crv = crs ? rows : columns;
+                for (unsigned int cr = 0; cr < picross.lineCount(crs); cr++) {
+                    this->scratch.queue.push(crs, cr, options.prioritize ? linePriority(picross, crs, cr, crv[cr]) : 0);
+                    stats->linesQueued++;
+                }
+            }
+            status = propagate(picross, rows, columns, this->scratch.queue, this->scratch.lineSolver, options, stats,
+                               nullptr, budget);
+        }
+        // A search probes at every node, its root included.
+        if (status == STUCK && options.deduction == PROBING && !options.search) {
+            picross.setTrailing(true);
+            status = probe(picross, rows, columns, this->scratch, options, stats, budget);
+            picross.setTrailing(false);
+        }
+    }
+    if (!options.search || status == CONTRADICTION || status == STOPPED) return status;
+    PC_PHASE(stats, searchNanos);
+    if (threaded) return parallelSearch(picross, rows, columns, solveOptions, *stats, budget);
+    return Search(picross, rows, columns, options, *stats, nullptr, &this->scratch, budget).run();
+}
+
+pc::Status solvePicross(pc::Grid& picross, const pc::ClueList& rows, const pc::ClueList& columns,
+                        const pc::SolveOptions& options, pc::SolveStats* stats) {
+    return pc::Solver().solve(picross, rows, columns, options, stats);
+}
+
+pc::Status solvePicross(pc::Grid& picross, const pc::Puzzle& puzzle, const pc::SolveOptions& options, pc::SolveStats* stats) {
+    return pc::Solver().solve(picross, puzzle, options, stats);
+}
+
+unsigned long long countSolutions(unsigned int width, unsigned int height, const pc::ClueList& rows,
+                                  const pc::ClueList& columns, unsigned long long limit) {
+    pc::Grid picross(width, height);
+    pc::SolveOptions options;
+    options.search = true;
+    options.solutionLimit = limit;
+    pc::SolveStats stats;
+    solvePicross(picross, rows, columns, options, &stats);
+    return stats.solutions;
+}
+
+void printPicross(const pc::Grid& picross) {
+    // One write and one flush for the whole grid rather than one per row.
+    std::string text;
+    for (unsigned int row = 0; row < picross.getHeight(); row++) {
+        for (unsigned int column = 0; column < picross.getWidth(); column++) {
+            text += char('0' + picross.get(row, column));
+            text += ' ';
+        }
+        text += '\n';
+    }
+    text += '\n';
+    std::cout << text << std::flush;
+}
@@ -0,0 +1,248 @@
+/*
+ * Solver.h
+ * Picross solving engine. Lines are handed to the line solver until no row or
+ * column yields anything new, which leaves the puzzle solved, stuck (line
+ * logic alone cannot finish it) or contradictory (the clues have no solution).
+ *
+ * Propagation is event driven: every line starts on a work queue, and after
+ * that a line is only queued again when one of its cells changes.
+ *
+ * With probing, a stuck puzzle is first probed: each unknown cell is tried
+ * both ways, keeping what either try proves (see Probe.h).
+ *
+ * With search enabled, a stuck puzzle is finished by guessing a cell and
+ * propagating, backing out of guesses that lead to a contradiction (see
+ * Search.h). Solutions can be counted or enumerated up to a limit, and the
+ * search can be spread over several threads.
+ *
+ * A solve can be given a deadline, a budget of line solves and a cancellation
+ * flag. When one of them stops it, it returns STOPPED with the cells proven so
+ * far in the grid: everything propagation deduced, without the guesses of a
+ * search that was under way.
+ */
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Grid.h"
+#include "LineQueue.h"
+#include "LineSolver.h"
+#include "Puzzle.h"
+
+namespace pc {
+    class LineCache;
+    class LineLog;
+    class PlacementTable;
+    class ThreadPool;
+
+    enum Status {
+        SOLVED,
+        STUCK,
+        CONTRADICTION,
+        STOPPED
+    };
+
+    // How hard propagation works before it gives up or the search guesses.
+    enum Deduction {
+        LINE_LOGIC, // Solve lines until none yields anything new.
+        PROBING     // Then probe unknown cells, at the root and at every search node.
+    };
+
+    // What SolveOptions::onProgress is told.
+    struct SolveProgress {
+        unsigned long long lineSolves; // So far, on every thread.
+        unsigned long long knownCells; // In the grid being worked on, a search's guesses included.
+        unsigned long long cells;
+        double seconds;                // Since the solve started.
+    };
+
+    struct SolveOptions {
+        // Solve the most constrained queued line first instead of FIFO order.
+        bool prioritize = false;
+        // Branch when propagation gets stuck instead of returning STUCK.
+        bool search = false;
+        Deduction deduction = LINE_LOGIC;
+        // Stop searching after this many solutions; 0 searches the whole tree.
+        unsigned long long solutionLimit = 1;
+        // Called with every solution found; returning false stops the search.
+        // A parallel search calls it from one worker at a time.
+        std::function<bool(const Grid&)> onSolution;
+        // Search threads. Above 1, branches become tasks on a work-stealing
+        // pool: pool if given, otherwise one created for this solve.
+        unsigned int threads = 1;
+        ThreadPool* pool = nullptr;
+        // Propagate the first pass by solving all dirty rows at once, then all
+        // dirty columns, on the same pool (see ParallelSweep.h).
+        bool parallelSweep = false;
+        // Memo of line solves to consult before solving a line and fill
+        // after; may be shared by any number of solves and threads.
+        LineCache* lineCache = nullptr;
+        // Lines it covers are solved from its list of fillings instead of by
+        // the line kernel. Read-only, so any number of solves can share it.
+        const PlacementTable* placements = nullptr;
+        // Stop with STOPPED at the deadline, after stepLimit line solves (0
+        // for no limit) or once *cancel is true, whichever comes first.
+        std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+        unsigned long long stepLimit = 0;
+        const std::atomic<bool>* cancel = nullptr;
+        // Called from a solving thread at most once per progressInterval.
+        std::function<void(const SolveProgress&)> onProgress;
+        std::chrono::milliseconds progressInterval = std::chrono::milliseconds(100);
+    };
+
+    /*
+     * The limits of one solve, from its options. The line solves done are
+     * reported to spend() in batches, and only every CHECK_STEPS of them does
+     * it read the clock, check the step limit and report progress, so a
+     * solve without limits pays nothing and one with limits almost nothing.
+     * The cancellation flag is read on every call. Shared by all the threads
+     * of a solve.
+     */
+    class SolveBudget {
+        public:
+            static const unsigned int CHECK_STEPS = 64;
+
+            explicit SolveBudget(const SolveOptions& options);
+
+            // Whether the options ask for anything a budget does.
+            static bool needed(const SolveOptions& options);
+
+            // Counts steps more line solves, working in picross; true once the solve must stop.
+            inline bool spend(unsigned long long steps, const Grid& picross) {
+                const unsigned long long total = this->steps.fetch_add(steps, std::memory_order_relaxed) + steps;
+                if (total >= this->nextCheck.load(std::memory_order_relaxed)) this->check(total, picross);
+                return this->stopped();
+            }
+            inline bool stopped() const {
+                return this->stop.load(std::memory_order_relaxed) ||
+                       (this->options.cancel && this->options.cancel->load(std::memory_order_relaxed));
+            }
+
+        private:
+            void check(unsigned long long total, const Grid& picross);
+
+            const SolveOptions& options;
+            const std::chrono::steady_clock::time_point start;
+            std::atomic<unsigned long long> steps, nextCheck;
+            std::atomic<bool> stop;
+            // Guards nextProgress; a thread that finds it taken skips the report.
+            std::mutex progressMutex;
+            std::chrono::steady_clock::time_point nextProgress;
+    };
+
+    struct SolveStats {
+        unsigned long long lineSolves = 0;   // Calls into the line solver.
+        unsigned long long linesQueued = 0;  // Lines pushed onto the work queue.
+        unsigned long long cellsChanged = 0; // Cells deduced.
+        unsigned long long searchNodes = 0;  // Propagations run by the search.
+        unsigned long long backtracks = 0;   // Guesses that ended in a contradiction.
+        unsigned long long solutions = 0;    // Solutions found by the search.
+        unsigned long long cacheLookups = 0; // Lines looked up in options.lineCache.
+        unsigned long long cacheHits = 0;    // Lookups answered without solving the line.
+        unsigned long long probes = 0;       // Cells tried both ways by probing.
+        unsigned long long probeCells = 0;   // Cells probing forced, propagation included.
+
+        // Only kept when built with PICROSS_INSTRUMENT (see Instrument.h).
+        unsigned long long rounds = 0;       // Propagation passes: one per propagate() and per parallel sweep.
+        unsigned long long sweepNanos = 0;   // Propagating before any search, completion checks included.
+        unsigned long long checkNanos = 0;   // Checking whether the grid is solved.
+        unsigned long long searchNanos = 0;  // Search, its own propagation included.
+        unsigned long long outputNanos = 0;  // Formatting results (batch mode).
+    };
+
+    inline void addStats(SolveStats& total, const SolveStats& part) {
+        total.lineSolves += part.lineSolves;
+        total.linesQueued += part.linesQueued;
+        total.cellsChanged += part.cellsChanged;
+        total.searchNodes += part.searchNodes;
+        total.backtracks += part.backtracks;
+        total.solutions += part.solutions;
+        total.cacheLookups += part.cacheLookups;
+        total.cacheHits += part.cacheHits;
+        total.probes += part.probes;
+        total.probeCells += part.probeCells;
+        total.rounds += part.rounds;
+        total.sweepNanos += part.sweepNanos;
+        total.checkNanos += part.checkNanos;
+        total.searchNanos += part.searchNanos;
+        total.outputNanos += part.outputNanos;
+    }
+
+    const char* statusName(Status status);
+
+    /*
+     * Appends the stats as the fields of a JSON object, without braces:
+     * "line_solves": 12, ... Rounds and phase times are only included when
+     * they were kept.
+     */
+    void appendStatsJson(std::string& out, const SolveStats& stats);
+
+    /*
+     * Runs the line solver on queued lines until the queue is empty, queueing
+     * the crossing line of every cell that changes. Every line solve that
+     * changes cells is recorded in log, if given (see Session.h). Returns
+     * STOPPED if budget runs out first, leaving the lines not yet solved in
+     * the queue.
+     */
+    Status propagate(Grid& picross, const ClueList& rows, const ClueList& columns,
+                     LineQueue& queue, LineSolver& lineSolver, const SolveOptions& options, SolveStats* stats,
+                     LineLog* log = nullptr, SolveBudget* budget = nullptr);
+
+    /*
+     * The buffers a solve works in: a line solver for long lines, the work
+     * queue, the search's copy of its first solution and probing's state.
+     * Whoever keeps one between solves (a Solver, a SolveSession) makes
+     * solving puzzle after puzzle allocate only when one is bigger than every
+     * puzzle before it.
+     */
+    struct SolveScratch {
+        LineSolver lineSolver;
+        LineQueue queue;
+        Grid solution;
+        // Row planes of the grid before a probe, and after its first try.
+        std::vector<word> probeBase, probeSide;
+        // Per cell: when it was last probed, and the lines its probe solved.
+        std::vector<unsigned long long> probeStamps;
+        std::vector<uint64_t> probeLines;
+        std::vector<uint64_t> probeOrder;
+        std::vector<unsigned int> probeCounts;
+    };
+
+    /*
+     * Reusable engine behind solvePicross. It keeps its SolveScratch between
+     * solves, so that a steady-state solve allocates nothing.
+     */
+    class Solver {
+        public:
+            Status solve(Grid& picross, const ClueList& rows, const ClueList& columns,
+                         const SolveOptions& options = SolveOptions(), SolveStats* stats = nullptr);
+            inline Status solve(Grid& picross, const Puzzle& puzzle, const SolveOptions& options = SolveOptions(),
+                                SolveStats* stats = nullptr) {
+                return this->solve(picross, puzzle.rows, puzzle.columns, options, stats);
+            }
+
+        private:
+            SolveScratch scratch;
+    };
+};
+
+/*
+ * Solves the puzzle into picross. With options.search, SOLVED leaves the first
+ * solution in the grid and CONTRADICTION means the clues have no solution. A
+ * search stopped after finding a solution still returns SOLVED, having
+ * counted fewer solutions than there may be.
+ */
+pc::Status solvePicross(pc::Grid& picross, const pc::ClueList& rows, const pc::ClueList& columns,
+                        const pc::SolveOptions& options = pc::SolveOptions(), pc::SolveStats* stats = nullptr);
+pc::Status solvePicross(pc::Grid& picross, const pc::Puzzle& puzzle,
+                        const pc::SolveOptions& options = pc::SolveOptions(), pc::SolveStats* stats = nullptr);
+/*
+ * Number of solutions of the puzzle, counting no further than limit (0 for no
+ * limit). A limit of 2 is enough to tell whether a solution is unique.
+ */
+unsigned long long countSolutions(unsigned int width, unsigned int height, const pc::ClueList& rows,
+                                  const pc::ClueList& columns, unsigned long long limit);
+void printPicross(const pc::Grid& picross);
@@ -0,0 +1,123 @@
+#include <algorithm>
+#include "ThreadPool.h"
+
+static thread_local const pc::ThreadPool* currentPool = nullptr;
+static thread_local int currentIndex = -1;
+
+pc::ThreadPool::ThreadPool(unsigned int threads)
+    : queuedCount(0), unfinished(0), nextWorker(0), stopping(false)
+{
+    if (!threads) threads = 1;
+    for (unsigned int i = 0; i < threads; i++) this->workers.emplace_back(new Worker());
+    for (unsigned int i = 0; i < threads; i++) this->threads.emplace_back(&ThreadPool::run, this, i);
+}
+
+pc::ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(this->sleepMutex);
+        this->stopping = true;
+    }
+    this->wake.notify_all();
+    for (auto& thread : this->threads) thread.join();
+}
+
+int pc::ThreadPool::currentWorker() const {
+    return currentPool == this ? currentIndex : -1;
+}
+
+void pc::ThreadPool::submit(std::function<void()> task) {
+    const int self = this->currentWorker();
+    const unsigned int index = self >= 0 ? self : this->nextWorker++ % this->workers.size();
+    this->unfinished++;
+    {
+        // Counted under the sleep lock so a worker going to sleep cannot miss
+        // it, and before the push so a thief never takes it uncounted.
+        std::lock_guard<std::mutex> lock(this->sleepMutex);
+        this->queuedCount++;
+    }
+    {
+        std::lock_guard<std::mutex> lock(this->workers[index]->mutex);
+        this->workers[index]->tasks.push_back(std::move(task));
+    }
+    this->wake.notify_one();
+}
+
+void pc::ThreadPool::TaskRing::push_back(std::function<void()>&& task) {
+    if (this->count == this->tasks.size()) {
+        // Full: unroll into a ring twice the size.
+        std::vector<std::function<void()>> grown(std::max<size_t>(16, 2 * this->tasks.size()));
+        for (size_t i = 0; i < this->count; i++) grown[i] = std::move(this->tasks[(this->head + i) % this->tasks.size()]);
+        this->tasks.swap(grown);
+        this->head = 0;
+    }
+    this->tasks[(this->head + this->count++) % this->tasks.size()] = std::move(task);
+}
+
+void pc::ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(this->sleepMutex);
+    this->done.wait(lock, [&]() { return this->unfinished.load() == 0; });
+}
+
+void pc::ThreadPool::parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& body) {
+    if (!count) return;
+    if (!grain) grain = 1;
+    std::mutex mutex;
+    std::condition_variable finished;
+    size_t remaining = (count + grain - 1) / grain;
+    for (size_t begin = 0; begin < count; begin += grain) {
+        const size_t end = begin + grain < count ? begin + grain : count;
+        this->submit([&, begin, end]() {
+            body(begin, end);
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!--remaining) finished.notify_all();
+        });
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [&]() { return !remaining; });
+}
+
+bool pc::ThreadPool::take(unsigned int index, std::function<void()>& task) {
+    {
+        // Own deque: newest first.
+        Worker& own = *this->workers[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            this->queuedCount--;
+            return true;
+        }
+    }
+    for (unsigned int i = 1; i < this->workers.size(); i++) {
+        // Someone else's deque: oldest first.
+        Worker& victim = *this->workers[(index + i) % this->workers.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            this->queuedCount--;
+            return true;
+        }
+    }
+    return false;
+}
+
+void pc::ThreadPool::run(unsigned int index) {
+    currentPool = this;
+    currentIndex = index;
+    std::function<void()> task;
+    while (true) {
+        if (this->take(index, task)) {
+            task();
+            task = nullptr;
+            if (--this->unfinished == 0) {
+                std::lock_guard<std::mutex> lock(this->sleepMutex);
+                this->done.notify_all();
+            }
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(this->sleepMutex);
+        this->wake.wait(lock, [&]() { return this->stopping || this->queuedCount.load() > 0; });
+        if (this->stopping && this->queuedCount.load() == 0) return;
+    }
+}
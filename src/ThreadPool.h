@@ -0,0 +1,86 @@
+/*
+ * ThreadPool.h
+ * Namespace pc: Work-stealing thread pool.
+ *
+ * Every worker owns a deque of tasks. A task submitted from inside a worker
+ * goes onto that worker's own deque, which the worker runs newest first so
+ * depth-first work stays hot in its cache. An idle worker steals the oldest
+ * task from another worker's deque; in a search tree those are the branches
+ * closest to the root and so the largest pieces of work.
+ */
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace pc {
+    class ThreadPool {
+        public:
+            explicit ThreadPool(unsigned int threads);
+            ~ThreadPool();
+            ThreadPool(const ThreadPool&) = delete;
+            ThreadPool& operator=(const ThreadPool&) = delete;
+
+            void submit(std::function<void()> task);
+            // Blocks until every submitted task has finished. Not for use by tasks.
+            void wait();
+            /*
+             * Runs body(begin, end) over [0, count) in chunks of at most grain
+             * and returns once every chunk is done. Only waits for its own
+             * chunks, so other work may share the pool. Not for use by tasks.
+             */
+            void parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& body);
+
+            inline unsigned int size() const { return this->workers.size(); }
+            // Tasks submitted but not yet picked up by a worker.
+            inline unsigned int queued() const { return this->queuedCount.load(std::memory_order_relaxed); }
+            // Index of the calling worker in this pool, or -1 for other threads.
+            int currentWorker() const;
+
+        private:
+            /*
+             * Deque of tasks in a ring that only grows, so once it has held
+             * the most tasks its worker ever queues, pushing and popping no
+             * longer allocate.
+             */
+            class TaskRing {
+                public:
+                    TaskRing() : head(0), count(0) {}
+
+                    void push_back(std::function<void()>&& task);
+                    inline bool empty() const { return !this->count; }
+                    inline std::function<void()>& front() { return this->tasks[this->head]; }
+                    inline std::function<void()>& back() {
+                        return this->tasks[(this->head + this->count - 1) % this->tasks.size()];
+                    }
+                    inline void pop_front() {
+                        this->head = (this->head + 1) % this->tasks.size();
+                        this->count--;
+                    }
+                    inline void pop_back() { this->count--; }
+
+                private:
+                    std::vector<std::function<void()>> tasks;
+                    size_t head, count;
+            };
+
+            struct Worker {
+                std::mutex mutex;
+                TaskRing tasks;
+            };
+
+            void run(unsigned int index);
+            bool take(unsigned int index, std::function<void()>& task);
+
+            std::vector<std::unique_ptr<Worker>> workers;
+            std::vector<std::thread> threads;
+            std::mutex sleepMutex;
+            std::condition_variable wake, done;
+            std::atomic<unsigned int> queuedCount, unfinished, nextWorker;
+            bool stopping;
+    };
+};
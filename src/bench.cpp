@@ -0,0 +1,1064 @@
+/* Picross Benchmarks
+ * Grid: compares the legacy unsigned int** grid against the bit-packed
+ * pc::Grid: bytes of cell storage, and cells per second for a full completion
+ * pass (count the filled and known cells of every row and column, the work
+ * checkCompletedRC does each round).
+ * Propagation: line solver calls per solve on random puzzles, with the FIFO
+ * and most-constrained-first work queues.
+ * Search: time to enumerate every solution of random puzzles that need many
+ * guesses, by search thread count, and the speedup over one thread.
+ * Sweep: time to propagate one large generated puzzle with parallel sweeps,
+ * by thread count.
+ * Parse: puzzles/s and MB/s reading .non and compact corpora from a file.
+ * Session: milliseconds per single-cell edit of a large puzzle with an
+ * incremental SolveSession, against solving the edited puzzle from scratch.
+ * Cache: time to solve the search-heavy corpus suites once, without and with a
+ * shared line cache, and the cache's hit rate.
+ * Budget: time to solve the search-heavy corpus suites without and with a
+ * deadline, step limit, cancellation flag and progress callback that never
+ * fire, how long after its deadline a search that cannot finish stops, and
+ * a check that a solve stopped by its step limit reports every line solve
+ * it made (the benchmark fails if not).
+ * Probe: search nodes, probes and median and p99 latency per puzzle with line
+ * logic alone and with probing, on the search-heavy corpus suites and on
+ * sparse 30x30 and 35x35 random puzzles proven unique.
+ * Placements: time to build, save and map a placement table for lines of up
+ * to 20 cells, and nanoseconds per line solved from it against the line
+ * kernel, by line length.
+ * Output: bytes per puzzle and write throughput of solved grids as text lines
+ * (as --batch prints them) and as binary records through a SolutionWriter,
+ * and how often the writer's queue was full.
+ * Batch: puzzles/s through solveBatch, as --batch runs, and the heap
+ * allocations the whole batch made, in total and per puzzle. They are the
+ * batch's setup and warm-up, so four times the puzzles makes about as many.
+ * Large: time and line solves for a 4000x4000 puzzle of overlapping
+ * rectangles swept as --solve-large does, with the grid on the heap and in
+ * a mapped file, its bits per cell, the time to stream it out as a 1 bpp
+ * BMP, and peak RSS.
+ * Corpus: solve latency (median and p99), puzzles/s, heap allocations per
+ * puzzle and peak RSS over a fixed corpus: the curated puzzles in
+ * corpus/curated.non plus seeded random puzzles from 5x5 to 100x100 and
+ * puzzles with many solutions that are enumerated in full. Before it runs,
+ * random puzzles of every fixed solver size and of sizes next to them, such
+ * as 4x105 and 14x115, must all be solved; the bench fails otherwise.
+ *
+ * picross-bench [--json file] [grid|propagation|search|sweep|parse|session|cache|budget|probe|placements|output|batch|large|corpus]...
+ * runs the named sections, or all of them; --json also writes the corpus
+ * results to file. Every input is fixed or seeded, so results from different
+ * commits built with the same Makefile are comparable.
+ */
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+#include "Batch.h"
+#include "Bitmap.h"
+#include "Grid.h"
+#include "LineCache.h"
+#include "LineKernel.h"
+#include "PlacementTable.h"
+#include "Puzzle.h"
+#include "Session.h"
+#include "SolutionFile.h"
+#include "Solver.h"
+#include "ThreadPool.h"
+
+typedef std::chrono::steady_clock benchClock;
+
+// Every heap allocation in the process, for allocations per puzzle.
+static std::atomic<unsigned long long> allocations(0), allocatedBytes(0);
+
+/*
+ * Every form of operator new counts through allocate(), and every form of
+ * operator delete frees through release(). Neither is inlined, so the
+ * compiler does not pair an inlined malloc or free with the other side's
+ * operator and warn about a mismatch.
+ */
+__attribute__((noinline)) static void* allocate(size_t size, size_t alignment = 0) noexcept {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    if (!size) size = 1;
+    if (!alignment) return malloc(size);
+    // aligned_alloc wants a multiple of the alignment.
+    return aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+}
+__attribute__((noinline)) static void release(void* memory) noexcept { free(memory); }
+
+void* operator new(size_t size) {
+    if (void* memory = allocate(size)) return memory;
+    throw std::bad_alloc();
+}
+void* operator new[](size_t size) {
+    if (void* memory = allocate(size)) return memory;
+    throw std::bad_alloc();
+}
+void* operator new(size_t size, std::align_val_t alignment) {
+    if (void* memory = allocate(size, size_t(alignment))) return memory;
+    throw std::bad_alloc();
+}
+void* operator new[](size_t size, std::align_val_t alignment) {
+    if (void* memory = allocate(size, size_t(alignment))) return memory;
+    throw std::bad_alloc();
+}
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return allocate(size, size_t(alignment));
+}
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return allocate(size, size_t(alignment));
+}
+void operator delete(void* memory) noexcept { release(memory); }
+void operator delete[](void* memory) noexcept { release(memory); }
+void operator delete(void* memory, size_t) noexcept { release(memory); }
+void operator delete[](void* memory, size_t) noexcept { release(memory); }
+void operator delete(void* memory, std::align_val_t) noexcept { release(memory); }
+void operator delete[](void* memory, std::align_val_t) noexcept { release(memory); }
+void operator delete(void* memory, size_t, std::align_val_t) noexcept { release(memory); }
+void operator delete[](void* memory, size_t, std::align_val_t) noexcept { release(memory); }
+void operator delete(void* memory, const std::nothrow_t&) noexcept { release(memory); }
+void operator delete[](void* memory, const std::nothrow_t&) noexcept { release(memory); }
+void operator delete(void* memory, std::align_val_t, const std::nothrow_t&) noexcept { release(memory); }
+void operator delete[](void* memory, std::align_val_t, const std::nothrow_t&) noexcept { release(memory); }
+
+static double secondsSince(const benchClock::time_point& start) {
+    return std::chrono::duration<double>(benchClock::now() - start).count();
+}
+
+static void benchGrid(unsigned int size, unsigned int passes) {
+    std::mt19937 rng(size);
+    std::uniform_int_distribution<int> state(0, 2);
+
+    unsigned int** legacy = new unsigned int*[size];
+    for (unsigned int i = 0; i < size; i++) legacy[i] = new unsigned int[size];
+    pc::Grid grid(size, size);
+    for (unsigned int row = 0; row < size; row++) {
+        for (unsigned int column = 0; column < size; column++) {
+            legacy[row][column] = state(rng);
+            grid.set(row, column, legacy[row][column]);
+        }
+    }
+
+    // Legacy pass: one load and compare per cell, columns strided across rows.
+    unsigned long long legacyCount = 0;
+    auto start = benchClock::now();
+    for (unsigned int pass = 0; pass < passes; pass++) {
+        for (unsigned int row = 0; row < size; row++) {
+            for (unsigned int column = 0; column < size; column++) {
+                legacyCount += (legacy[row][column] == 1) + (legacy[row][column] != 0);
+            }
+        }
+        for (unsigned int column = 0; column < size; column++) {
+            for (unsigned int row = 0; row < size; row++) {
+                legacyCount += (legacy[row][column] == 1) + (legacy[row][column] != 0);
+            }
+        }
+    }
+    const double legacySeconds = secondsSince(start);
+
+    // Packed pass: popcounts over consecutive words in both orientations.
+    unsigned long long packedCount = 0;
+    start = benchClock::now();
+    for (unsigned int pass = 0; pass < passes; pass++) {
+        for (unsigned char crs = 0; crs < 2; crs++) {
+            for (unsigned int cr = 0; cr < size; cr++) {
+                packedCount += grid.countFilled(crs, cr) + grid.countKnown(crs, cr);
+            }
+        }
+    }
+    const double packedSeconds = secondsSince(start);
+
+    if (legacyCount != packedCount) std::cerr << "mismatch at " << size << "x" << size << std::endl;
+
+    const double cells = 2.0 * size * size * passes;
+    const size_t legacyBytes = size_t(size) * size * sizeof(unsigned int) + size * sizeof(unsigned int*);
+    std::cout << std::setw(5) << size << "x" << std::left << std::setw(6) << size << std::right
+              << std::setw(12) << legacyBytes << std::setw(12) << grid.memoryUsage()
+              << std::setw(14) << std::fixed << std::setprecision(1) << cells / legacySeconds / 1e6
+              << std::setw(14) << cells / packedSeconds / 1e6 << std::endl;
+
+    for (unsigned int i = 0; i < size; i++) delete[] legacy[i];
+    delete[] legacy;
+}
+
+/*
+ * Clues of a width x height grid of 0/1 cells, stored row-major.
+ */
+static void cellsToClues(const std::vector<uint8_t>& cells, unsigned int width, unsigned int height,
+                         pc::ClueList& rows, pc::ClueList& columns) {
+    auto encode = [&](unsigned int count, unsigned int length, size_t start, size_t step, pc::ClueList& clues) {
+        clues.clear();
+        for (unsigned int cr = 0; cr < count; cr++) {
+            unsigned int run = 0;
+            bool any = false;
+            clues.addLine();
+            for (unsigned int i = 0; i <= length; i++) {
+                if (i < length && cells[start * cr + step * i]) run++;
+                else if (run) { clues.push(run); run = 0; any = true; }
+            }
+            if (!any) clues.push(0);
+        }
+    };
+    encode(height, width, width, 1, rows);
+    encode(width, height, 1, width, columns);
+}
+
+static std::vector<uint8_t> randomCells(unsigned int width, unsigned int height, double density, unsigned int seed) {
+    std::mt19937 rng(seed);
+    std::bernoulli_distribution fill(density);
+    std::vector<uint8_t> cells(size_t(width) * height);
+    for (auto& cell : cells) cell = fill(rng);
+    return cells;
+}
+
+/*
+ * Random puzzle with the given fill density: the clues are read back off a
+ * random grid, so the puzzle always has at least one solution.
+ */
+static void makePuzzle(unsigned int width, unsigned int height, double density, unsigned int seed,
+                       pc::ClueList& rows, pc::ClueList& columns) {
+    cellsToClues(randomCells(width, height, density, seed), width, height, rows, columns);
+}
+
+static void benchPropagation(unsigned int size, double density, unsigned int puzzles) {
+    for (int prioritize = 0; prioritize < 2; prioritize++) {
+        pc::SolveOptions options;
+        options.prioritize = prioritize;
+        pc::SolveStats stats;
+        unsigned int solved = 0;
+        pc::ClueList rows, columns;
+        pc::Grid grid(size, size);
+        auto start = benchClock::now();
+        for (unsigned int seed = 0; seed < puzzles; seed++) {
+            makePuzzle(size, size, density, seed, rows, columns);
+            grid.clear();
+            solved += solvePicross(grid, rows, columns, options, &stats) == pc::SOLVED;
+        }
+        const double seconds = secondsSince(start);
+        std::cout << std::setw(5) << size << "x" << std::left << std::setw(6) << size << std::right
+                  << std::setw(9) << std::setprecision(2) << density
+                  << std::setw(10) << (prioritize ? "priority" : "fifo")
+                  << std::setw(8) << solved << "/" << std::left << std::setw(5) << puzzles << std::right
+                  << std::setw(14) << stats.lineSolves / puzzles
+                  << std::setw(12) << std::setprecision(1) << double(stats.lineSolves) / puzzles / (2 * size)
+                  << std::setw(12) << std::setprecision(3) << seconds * 1e3 / puzzles << std::endl;
+    }
+}
+
+static void benchSearch(unsigned int size, double density, unsigned int puzzles) {
+    std::vector<pc::ClueList> rows(puzzles), columns(puzzles);
+    for (unsigned int seed = 0; seed < puzzles; seed++) makePuzzle(size, size, density, 1000 + seed, rows[seed], columns[seed]);
+
+    double serialSeconds = 0;
+    for (unsigned int threads = 1; threads <= 16; threads *= 2) {
+        pc::ThreadPool pool(threads);
+        pc::SolveOptions options;
+        options.search = true;
+        options.solutionLimit = 0;
+        options.threads = threads;
+        options.pool = threads > 1 ? &pool : nullptr;
+        pc::SolveStats stats;
+        pc::Grid grid(size, size);
+        auto start = benchClock::now();
+        for (unsigned int i = 0; i < puzzles; i++) {
+            grid.clear();
+            solvePicross(grid, rows[i], columns[i], options, &stats);
+        }
+        const double seconds = secondsSince(start);
+        if (threads == 1) serialSeconds = seconds;
+        std::cout << std::setw(5) << size << "x" << std::left << std::setw(6) << size << std::right
+                  << std::setw(9) << threads << std::setw(12) << stats.searchNodes / puzzles
+                  << std::setw(12) << stats.solutions / puzzles
+                  << std::setw(12) << std::setprecision(3) << seconds * 1e3 / puzzles
+                  << std::setw(10) << std::setprecision(2) << serialSeconds / seconds << std::endl;
+    }
+}
+
+static void benchSweep(unsigned int size, double density) {
+    pc::ClueList rows, columns;
+    makePuzzle(size, size, density, 7, rows, columns);
+
+    double serialSeconds = 0;
+    for (unsigned int threads = 1; threads <= 16; threads *= 2) {
+        pc::ThreadPool pool(threads);
+        pc::SolveOptions options;
+        options.parallelSweep = true;
+        options.threads = threads;
+        options.pool = &pool;
+        pc::SolveStats stats;
+        pc::Grid grid(size, size);
+        auto start = benchClock::now();
+        const pc::Status status = solvePicross(grid, rows, columns, options, &stats);
+        const double seconds = secondsSince(start);
+        if (threads == 1) serialSeconds = seconds;
+        std::cout << std::setw(5) << size << "x" << std::left << std::setw(6) << size << std::right
+                  << std::setw(9) << threads << std::setw(14) << pc::statusName(status)
+                  << std::setw(12) << stats.lineSolves
+                  << std::setw(12) << std::setprecision(1) << seconds * 1e3
+                  << std::setw(10) << std::setprecision(2) << serialSeconds / seconds << std::endl;
+    }
+}
+
+static void benchParse(unsigned int size, unsigned int puzzles, bool compact) {
+    pc::Puzzle puzzle;
+    std::string corpus;
+    pc::ClueList rows, columns;
+    for (unsigned int seed = 0; seed < puzzles; seed++) {
+        makePuzzle(size, size, 0.55, seed, rows, columns);
+        puzzle.width = puzzle.height = size;
+        puzzle.rows = rows;
+        puzzle.columns = columns;
+        if (compact) pc::appendCompact(corpus, puzzle);
+        else pc::appendNon(corpus, puzzle);
+    }
+    const char* filename = "picross-bench-corpus.tmp";
+    std::ofstream(filename, std::ofstream::binary).write(corpus.data(), corpus.size());
+
+    pc::PuzzleReader reader;
+    unsigned int read = 0;
+    auto start = benchClock::now();
+    reader.open(filename);
+    while (reader.next(puzzle)) read++;
+    const double seconds = secondsSince(start);
+    reader.close();
+    std::remove(filename);
+
+    std::cout << std::setw(5) << size << "x" << std::left << std::setw(6) << size << std::right
+              << std::setw(10) << (compact ? "compact" : ".non") << std::setw(10) << read
+              << std::setw(14) << std::fixed << std::setprecision(0) << read / seconds
+              << std::setw(10) << std::setprecision(1) << corpus.size() / seconds / 1e6 << std::endl;
+}
+
+struct CorpusSuite {
+    std::string name;
+    std::vector<pc::Puzzle> puzzles;
+    // Solutions to look for; 2 proves uniqueness, 0 enumerates them all.
+    unsigned long long solutionLimit;
+    unsigned int repeat;
+};
+
+static pc::Puzzle randomPuzzle(unsigned int size, double density, unsigned int seed) {
+    pc::Puzzle puzzle;
+    puzzle.width = puzzle.height = size;
+    makePuzzle(size, size, density, seed, puzzle.rows, puzzle.columns);
+    return puzzle;
+}
+
+static void addRandomSuite(std::vector<CorpusSuite>& suites, unsigned int size, double density, unsigned int puzzles,
+                           unsigned int repeat) {
+    CorpusSuite suite{"random-" + std::to_string(size), {}, 2, repeat};
+    for (unsigned int seed = 0; seed < puzzles; seed++) suite.puzzles.push_back(randomPuzzle(size, density, 5000 + seed));
+    suites.push_back(std::move(suite));
+}
+
+static std::vector<CorpusSuite> buildCorpus() {
+    std::vector<CorpusSuite> suites;
+    CorpusSuite curated{"curated", {}, 0, 50};
+    pc::PuzzleReader reader;
+    pc::Puzzle puzzle;
+    if (reader.open("corpus/curated.non")) {
+        while (reader.next(puzzle)) curated.puzzles.push_back(puzzle);
+    }
+    if (curated.puzzles.empty()) std::cerr << "corpus/curated.non missing, skipping the curated suite" << std::endl;
+    else suites.push_back(std::move(curated));
+
+    addRandomSuite(suites, 5, 0.5, 2000, 5);
+    addRandomSuite(suites, 15, 0.55, 500, 3);
+    addRandomSuite(suites, 30, 0.6, 100, 2);
+    addRandomSuite(suites, 100, 0.7, 10, 1);
+
+    // Sparser random puzzles can take the search minutes to prove unique.
+    CorpusSuite mixed{"random-density", {}, 2, 2};
+    std::mt19937 rng(99);
+    std::uniform_real_distribution<double> density(0.55, 0.85);
+    for (unsigned int seed = 0; seed < 200; seed++) mixed.puzzles.push_back(randomPuzzle(20, density(rng), 6000 + seed));
+    suites.push_back(std::move(mixed));
+
+    // Every row and column holds one filled cell: all 7! permutation grids
+    // solve it, and line logic alone deduces nothing.
+    CorpusSuite permutations{"multi-permutation-7", {}, 0, 3};
+    puzzle.resize(7, 7);
+    for (unsigned int line = 0; line < 7; line++) {
+        puzzle.rows.set(line, {1});
+        puzzle.columns.set(line, {1});
+    }
+    permutations.puzzles.push_back(puzzle);
+    suites.push_back(std::move(permutations));
+
+    CorpusSuite multi{"multi-random-20", {}, 0, 1};
+    for (unsigned int seed = 0; seed < 4; seed++) multi.puzzles.push_back(randomPuzzle(20, 0.5, 1000 + seed));
+    suites.push_back(std::move(multi));
+    return suites;
+}
+
+static std::string jsonNumber(double value) {
+    char text[32];
+    snprintf(text, sizeof(text), "%.6g", value);
+    return text;
+}
+
+/*
+ * Solves every puzzle of the suite repeat times with one reused Solver and
+ * Grid, as a batch worker would, after one untimed warm-up pass over the
+ * first few puzzles. Appends the suite's JSON object to json.
+ */
+static void benchCorpus(const CorpusSuite& suite, std::string& json) {
+    pc::SolveOptions options;
+    options.search = true;
+    options.solutionLimit = suite.solutionLimit;
+    pc::Solver solver;
+    pc::Grid grid;
+    for (size_t i = 0; i < suite.puzzles.size() && i < 10; i++) {
+        grid.resize(suite.puzzles[i].width, suite.puzzles[i].height);
+        solver.solve(grid, suite.puzzles[i], options);
+    }
+
+    std::vector<double> latencies;
+    latencies.reserve(suite.puzzles.size() * suite.repeat);
+    unsigned long long statuses[3] = {0, 0, 0};
+    pc::SolveStats stats;
+    const unsigned long long allocationsBefore = allocations.load(), bytesBefore = allocatedBytes.load();
+    const auto start = benchClock::now();
+    for (unsigned int round = 0; round < suite.repeat; round++) {
+        for (const pc::Puzzle& puzzle : suite.puzzles) {
+            const auto solveStart = benchClock::now();
+            grid.resize(puzzle.width, puzzle.height);
+            statuses[solver.solve(grid, puzzle, options, &stats)]++;
+            latencies.push_back(secondsSince(solveStart) * 1e6);
+        }
+    }
+    const double seconds = secondsSince(start);
+    const double solves = latencies.size();
+    const double allocationsPer = (allocations.load() - allocationsBefore) / solves;
+    const double bytesPer = (allocatedBytes.load() - bytesBefore) / solves;
+
+    std::sort(latencies.begin(), latencies.end());
+    const double median = latencies[latencies.size() / 2];
+    const double p99 = latencies[std::min(latencies.size() - 1, size_t(latencies.size() * 0.99))];
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    const long peakKB = usage.ru_maxrss;
+
+    std::cout << std::left << std::setw(21) << suite.name << std::right << std::setw(8) << suite.puzzles.size()
+              << std::setw(8) << statuses[pc::SOLVED] << std::setw(12) << std::fixed << std::setprecision(1) << median
+              << std::setw(12) << p99 << std::setw(12) << std::setprecision(0) << solves / seconds
+              << std::setw(12) << std::setprecision(1) << allocationsPer << std::setw(12) << bytesPer / 1024
+              << std::setw(10) << peakKB / 1024 << std::endl;
+
+    if (json.size() > 1) json += ",";
+    json += "\n    {\"name\": \"" + suite.name + "\", \"puzzles\": " + std::to_string(suite.puzzles.size())
+          + ", \"solves\": " + std::to_string(latencies.size())
+          + ", \"solution_limit\": " + std::to_string(suite.solutionLimit)
+          + ", \"solved\": " + std::to_string(statuses[pc::SOLVED])
+          + ", \"stuck\": " + std::to_string(statuses[pc::STUCK])
+          + ", \"contradictions\": " + std::to_string(statuses[pc::CONTRADICTION])
+          + ", \"solutions\": " + std::to_string(stats.solutions)
+          + ", \"search_nodes\": " + std::to_string(stats.searchNodes)
+          + ", \"median_us\": " + jsonNumber(median) + ", \"p99_us\": " + jsonNumber(p99)
+          + ", \"puzzles_per_s\": " + jsonNumber(solves / seconds)
+          + ", \"allocations_per_puzzle\": " + jsonNumber(allocationsPer)
+          + ", \"allocated_bytes_per_puzzle\": " + jsonNumber(bytesPer)
+          + ", \"peak_rss_kb\": " + std::to_string(peakKB) + "}";
+}
+
+/*
+ * Edits a random image puzzle one cell at a time, as an editor would, and
+ * times each re-solve of a SolveSession against a cold solve of the edited
+ * puzzle.
+ */
+static void benchSession(unsigned int size, double density, unsigned int edits) {
+    std::vector<uint8_t> cells = randomCells(size, size, density, 4242);
+    pc::Puzzle puzzle;
+    puzzle.width = puzzle.height = size;
+    cellsToClues(cells, size, size, puzzle.rows, puzzle.columns);
+    pc::SolveSession session(puzzle);
+    auto start = benchClock::now();
+    session.solve();
+    const double cold = secondsSince(start);
+
+    std::mt19937 rng(size);
+    double incremental = 0, full = 0;
+    pc::Grid grid;
+    for (unsigned int edit = 0; edit < edits; edit++) {
+        const unsigned int row = rng() % size, column = rng() % size;
+        cells[size_t(row) * size + column] ^= 1;
+        cellsToClues(cells, size, size, puzzle.rows, puzzle.columns);
+        const pc::ClueLine rowClues = puzzle.rows[row], columnClues = puzzle.columns[column];
+        const std::vector<unsigned int> rowEdit(rowClues.begin(), rowClues.end());
+        const std::vector<unsigned int> columnEdit(columnClues.begin(), columnClues.end());
+        start = benchClock::now();
+        session.setRowClue(row, rowEdit);
+        session.setColumnClue(column, columnEdit);
+        session.solve();
+        incremental += secondsSince(start);
+
+        start = benchClock::now();
+        grid.resize(size, size);
+        solvePicross(grid, puzzle);
+        full += secondsSince(start);
+    }
+    std::cout << std::setw(5) << size << "x" << std::left << std::setw(6) << size << std::right
+              << std::setw(9) << std::fixed << std::setprecision(2) << density << std::setw(12) << std::setprecision(3)
+              << cold * 1e3 << std::setw(14) << incremental / edits * 1e3 << std::setw(12) << full / edits * 1e3
+              << std::setw(10) << std::setprecision(1) << full / incremental << std::endl;
+}
+
+/*
+ * Solves every puzzle of the suite with search on a fresh Solver, with and
+ * without a fresh 1 MiB line cache; the best of five runs counts.
+ */
+static void benchCache(const CorpusSuite& suite) {
+    double seconds[2] = {1e9, 1e9};
+    pc::SolveStats stats;
+    for (int run = 0; run < 5; run++) {
+        for (int cached = 0; cached < 2; cached++) {
+            pc::LineCache cache(1 << 20);
+            pc::SolveOptions options;
+            options.search = true;
+            options.solutionLimit = suite.solutionLimit;
+            if (cached) options.lineCache = &cache;
+            pc::Solver solver;
+            pc::Grid grid;
+            pc::SolveStats runStats;
+            const auto start = benchClock::now();
+            for (const pc::Puzzle& puzzle : suite.puzzles) {
+                grid.resize(puzzle.width, puzzle.height);
+                solver.solve(grid, puzzle, options, &runStats);
+            }
+            seconds[cached] = std::min(seconds[cached], secondsSince(start));
+            if (cached) stats = runStats;
+        }
+    }
+    std::cout << std::left << std::setw(21) << suite.name << std::right << std::setw(8) << suite.puzzles.size()
+              << std::setw(12) << std::fixed << std::setprecision(2) << seconds[0] * 1e3 << std::setw(12) << seconds[1] * 1e3
+              << std::setw(12) << stats.cacheLookups << std::setw(8) << std::setprecision(1)
+              << (stats.cacheLookups ? 100.0 * stats.cacheHits / stats.cacheLookups : 0.0) << std::setw(10)
+              << std::setprecision(2) << seconds[0] / seconds[1] << std::endl;
+}
+
+/*
+ * Solves every puzzle of the suite with search at each deduction level, and
+ * reports search nodes per puzzle and the median and p99 latency.
+ */
+static void benchProbe(const CorpusSuite& suite) {
+    for (pc::Deduction deduction : {pc::LINE_LOGIC, pc::PROBING}) {
+        pc::SolveOptions options;
+        options.search = true;
+        options.solutionLimit = suite.solutionLimit;
+        options.deduction = deduction;
+        pc::Solver solver;
+        pc::Grid grid;
+        pc::SolveStats stats;
+        std::vector<double> latencies;
+        for (const pc::Puzzle& puzzle : suite.puzzles) {
+            const auto start = benchClock::now();
+            grid.resize(puzzle.width, puzzle.height);
+            solver.solve(grid, puzzle, options, &stats);
+            latencies.push_back(secondsSince(start) * 1e3);
+        }
+        double total = 0;
+        for (double latency : latencies) total += latency;
+        std::sort(latencies.begin(), latencies.end());
+        std::cout << std::left << std::setw(21) << suite.name << std::setw(12)
+                  << (deduction == pc::PROBING ? "probing" : "line logic") << std::right
+                  << std::setw(8) << suite.puzzles.size() << std::setw(12) << stats.searchNodes / suite.puzzles.size()
+                  << std::setw(12) << stats.probes / suite.puzzles.size() << std::setw(12) << std::fixed
+                  << std::setprecision(3) << latencies[latencies.size() / 2]
+                  << std::setw(12) << latencies[std::min(latencies.size() - 1, size_t(latencies.size() * 0.99))]
+                  << std::setw(12) << std::setprecision(1) << total << std::endl;
+    }
+}
+
+/*
+ * Solves every puzzle of the suite with search on a fresh Solver, with no
+ * limits and with limits that are never reached; the best of five runs counts.
+ */
+static void benchBudget(const CorpusSuite& suite) {
+    double seconds[2] = {1e9, 1e9};
+    std::atomic<bool> cancel(false);
+    unsigned long long reports = 0;
+    for (int run = 0; run < 5; run++) {
+        for (int limited = 0; limited < 2; limited++) {
+            pc::SolveOptions options;
+            options.search = true;
+            options.solutionLimit = suite.solutionLimit;
+            if (limited) {
+                options.deadline = benchClock::now() + std::chrono::hours(1);
+                options.stepLimit = ~0ull;
+                options.cancel = &cancel;
+                options.onProgress = [&](const pc::SolveProgress&) { reports++; };
+            }
+            pc::Solver solver;
+            pc::Grid grid;
+            const auto start = benchClock::now();
+            for (const pc::Puzzle& puzzle : suite.puzzles) {
+                grid.resize(puzzle.width, puzzle.height);
+                solver.solve(grid, puzzle, options);
+            }
+            seconds[limited] = std::min(seconds[limited], secondsSince(start));
+        }
+    }
+    std::cout << std::left << std::setw(21) << suite.name << std::right << std::setw(8) << suite.puzzles.size()
+              << std::setw(12) << std::fixed << std::setprecision(2) << seconds[0] * 1e3 << std::setw(12) << seconds[1] * 1e3
+              << std::setw(12) << std::setprecision(1) << 100 * (seconds[1] / seconds[0] - 1) << std::endl;
+}
+
+// Enumerates every solution of a puzzle with far too many, until the deadline.
+static void benchDeadline(unsigned int size, unsigned int threads, unsigned int milliseconds) {
+    pc::Puzzle puzzle = randomPuzzle(size, 0.5, 7);
+    pc::SolveOptions options;
+    options.search = true;
+    options.solutionLimit = 0;
+    options.threads = threads;
+    options.deadline = benchClock::now() + std::chrono::milliseconds(milliseconds);
+    pc::Grid grid(size, size);
+    pc::SolveStats stats;
+    const auto start = benchClock::now();
+    const pc::Status status = pc::Solver().solve(grid, puzzle, options, &stats);
+    const double seconds = secondsSince(start);
+    std::cout << size << "x" << size << " on " << threads << (threads == 1 ? " thread" : " threads") << ", deadline "
+              << milliseconds << " ms: " << pc::statusName(status) << " after " << std::fixed << std::setprecision(2)
+              << seconds * 1e3 << " ms, " << stats.searchNodes << " nodes" << std::endl;
+}
+
+/*
+ * Checks that a solve stopped by its step limit accounts for every line
+ * solve: the last progress report, made when the limit is hit, must count
+ * as many as SolveStats::lineSolves. False on a mismatch.
+ */
+static bool checkStepReport(unsigned int size, bool search, bool cached, unsigned long long stepLimit) {
+    pc::Puzzle puzzle = randomPuzzle(size, 0.5, 7);
+    pc::LineCache cache(1 << 20);
+    pc::SolveOptions options;
+    options.search = search;
+    options.solutionLimit = 0;
+    options.stepLimit = stepLimit;
+    options.lineCache = cached ? &cache : nullptr;
+    options.progressInterval = std::chrono::milliseconds(0);
+    unsigned long long reported = 0;
+    options.onProgress = [&](const pc::SolveProgress& progress) { reported = progress.lineSolves; };
+    pc::Grid grid(size, size);
+    pc::SolveStats stats;
+    const pc::Status status = pc::Solver().solve(grid, puzzle, options, &stats);
+    const bool ok = status != pc::STOPPED || reported == stats.lineSolves;
+    std::cout << size << "x" << size << (search ? " search" : " line logic") << (cached ? ", cached" : "")
+              << ", step limit " << stepLimit << ": " << pc::statusName(status) << " after " << stats.lineSolves
+              << " line solves, " << reported << " reported" << (ok ? "" : "  MISMATCH") << std::endl;
+    return ok;
+}
+
+/*
+ * Random lines of one length, about a third of their cells known, solved
+ * passes times over by the line kernel and by the table, few enough to stay
+ * in cache; the best of five runs counts.
+ */
+static void benchPlacementLines(const pc::PlacementTable& table, unsigned int length, unsigned int lines, unsigned int passes) {
+    pc::ClueList clues, columns;
+    const std::vector<uint8_t> cells = randomCells(length, lines, 0.5, length);
+    cellsToClues(cells, length, lines, clues, columns);
+    std::mt19937 rng(length);
+    std::vector<pc::LineJob> jobs(lines);
+    for (unsigned int line = 0; line < lines; line++) {
+        uint64_t filled = 0, crossed = 0;
+        for (unsigned int i = 0; i < length; i++) {
+            if (rng() % 3) continue;
+            if (cells[size_t(line) * length + i]) filled |= uint64_t(1) << i;
+            else crossed |= uint64_t(1) << i;
+        }
+        pc::setLineJob(jobs[line], clues[line].data(), clues[line].size(), length, filled, crossed);
+    }
+    // Lines with too many fillings for the table go to the kernel afterwards.
+    std::vector<pc::LineJob> rest;
+    rest.reserve(lines);
+    size_t covered = 0;
+    double seconds[2] = {1e9, 1e9};
+    for (int run = 0; run < 5; run++) {
+        auto start = benchClock::now();
+        for (unsigned int pass = 0; pass < passes; pass++) pc::solveLineJobs(jobs.data(), lines);
+        seconds[0] = std::min(seconds[0], secondsSince(start) / passes);
+        start = benchClock::now();
+        for (unsigned int pass = 0; pass < passes; pass++) {
+            rest.clear();
+            for (pc::LineJob& job : jobs) {
+                if (!table.solve(job)) rest.push_back(job);
+            }
+            pc::solveLineJobs(rest.data(), rest.size());
+        }
+        seconds[1] = std::min(seconds[1], secondsSince(start) / passes);
+        covered = lines - rest.size();
+    }
+    std::cout << std::setw(8) << length << std::setw(10) << lines << std::setw(10) << std::fixed << std::setprecision(1)
+              << 100.0 * covered / lines << std::setw(12) << seconds[0] / lines * 1e9 << std::setw(12) << seconds[1] / lines * 1e9 << std::setw(10)
+              << std::setprecision(2) << seconds[0] / seconds[1] << std::endl;
+}
+
+static void benchPlacements() {
+    const char* path = "bench-placements.tmp";
+    pc::PlacementTable built, table;
+    auto start = benchClock::now();
+    built.build(20);
+    const double build = secondsSince(start);
+    start = benchClock::now();
+    const bool saved = built.save(path);
+    const double save = secondsSince(start);
+    start = benchClock::now();
+    const bool loaded = saved && table.load(path);
+    const double load = secondsSince(start);
+    std::remove(path);
+    if (!loaded) {
+        std::cerr << "Could not save and map a placement table: " << table.getError() << "." << std::endl;
+        return;
+    }
+    std::cout << "table for lines of up to 20 cells: " << (table.getBytes() >> 10) << " KiB, built in " << std::fixed
+              << std::setprecision(1) << build * 1e3 << " ms, saved in " << save * 1e3 << " ms, mapped in "
+              << load * 1e6 << " us" << std::endl;
+    std::cout << std::setw(8) << "length" << std::setw(10) << "lines" << std::setw(10) << "table %" << std::setw(12) << "kernel ns"
+              << std::setw(12) << "table ns" << std::setw(10) << "speedup" << std::endl;
+    for (unsigned int length : {8, 12, 16, 20}) benchPlacementLines(table, length, 2000, 50);
+}
+
+static void benchOutput(unsigned int size, double density, unsigned int puzzles) {
+    std::vector<pc::Grid> grids(puzzles);
+    std::vector<pc::Status> statuses(puzzles);
+    pc::Solver solver;
+    for (unsigned int seed = 0; seed < puzzles; seed++) {
+        const pc::Puzzle puzzle = randomPuzzle(size, density, 9000 + seed);
+        grids[seed].resize(size, size);
+        statuses[seed] = solver.solve(grids[seed], puzzle);
+    }
+    const char* path = "bench-output.tmp";
+
+    // Text lines, formatted and written by the producing thread.
+    auto start = benchClock::now();
+    std::ofstream text(path, std::ofstream::binary);
+    std::string line;
+    for (unsigned int i = 0; i < puzzles; i++) {
+        line = std::to_string(i) + ' ' + pc::statusName(statuses[i]) + ' ';
+        pc::appendGrid(line, grids[i]);
+        line += '\n';
+        text << line;
+    }
+    text.close();
+    const double textSeconds = secondsSince(start);
+    const unsigned long long textBytes = std::ifstream(path, std::ifstream::binary | std::ifstream::ate).tellg();
+
+    // Binary records, encoded here and written by the writer's thread.
+    start = benchClock::now();
+    pc::SolutionWriter writer;
+    writer.open(path);
+    std::string record;
+    for (unsigned int i = 0; i < puzzles; i++) {
+        pc::appendSolutionRecord(record, i, statuses[i], grids[i]);
+        writer.write(record);
+    }
+    const bool written = writer.close();
+    const double binarySeconds = secondsSince(start);
+    std::remove(path);
+    if (!written) {
+        std::cerr << "Could not write solutions: " << writer.getError() << "." << std::endl;
+        return;
+    }
+    const pc::SolutionWriterCounters& counters = writer.getCounters();
+
+    auto row = [&](const char* format, unsigned long long bytes, double seconds, unsigned long long stalls) {
+        std::cout << std::setw(5) << size << "x" << std::left << std::setw(6) << size << std::right
+                  << std::setw(10) << format << std::setw(10) << puzzles << std::setw(12) << std::fixed
+                  << std::setprecision(1) << double(bytes) / puzzles << std::setw(12) << std::setprecision(0)
+                  << puzzles / seconds << std::setw(10) << std::setprecision(1) << bytes / seconds / 1e6
+                  << std::setw(10) << stalls << std::endl;
+    };
+    row("text", textBytes, textSeconds, 0);
+    row("binary", counters.bytes, binarySeconds, counters.stalls);
+}
+
+/*
+ * Solves a corpus of random puzzles with solveBatch, as --batch does, into
+ * /dev/null, and counts the heap allocations the whole batch made.
+ */
+static void benchBatch(unsigned int size, double density, unsigned int puzzles, unsigned int threads) {
+    pc::Puzzle puzzle;
+    std::string corpus;
+    for (unsigned int seed = 0; seed < puzzles; seed++) {
+        puzzle = randomPuzzle(size, density, 11000 + seed);
+        pc::appendCompact(corpus, puzzle);
+    }
+    std::ofstream out("/dev/null", std::ofstream::binary);
+    pc::BatchOptions options;
+    options.threads = threads;
+    pc::PuzzleReader reader;
+    reader.open(corpus.data(), corpus.size());
+    const unsigned long long allocationsBefore = allocations.load();
+    auto start = benchClock::now();
+    const pc::BatchSummary summary = pc::solveBatch(reader, out, options);
+    const double seconds = secondsSince(start);
+    const unsigned long long batchAllocations = allocations.load() - allocationsBefore;
+
+    std::cout << std::setw(5) << size << "x" << std::left << std::setw(6) << size << std::right
+              << std::setw(9) << threads << std::setw(10) << summary.puzzles << std::setw(10) << summary.solved
+              << std::setw(12) << std::fixed << std::setprecision(0) << summary.puzzles / seconds
+              << std::setw(14) << batchAllocations << std::setw(12) << std::setprecision(3)
+              << double(batchAllocations) / summary.puzzles << std::endl;
+}
+
+/*
+ * A size x size image of rectangles up to an eighth of the side, overlapping
+ * at random: few clues per line, and line logic alone solves it.
+ */
+static std::vector<uint8_t> rectangleCells(unsigned int size, unsigned int rectangles, unsigned int seed) {
+    std::mt19937 rng(seed);
+    std::vector<uint8_t> cells(size_t(size) * size);
+    for (unsigned int i = 0; i < rectangles; i++) {
+        const unsigned int width = 1 + rng() % (size / 8), height = 1 + rng() % (size / 8);
+        const unsigned int left = rng() % (size - width), top = rng() % (size - height);
+        for (unsigned int row = top; row < top + height; row++) {
+            std::fill(&cells[size_t(row) * size + left], &cells[size_t(row) * size + left + width], 1);
+        }
+    }
+    return cells;
+}
+
+/*
+ * Solves one large rectangle puzzle as --solve-large does, with its grid on
+ * the heap or in a mapped file, then streams it out as a 1 bpp BMP.
+ */
+static void benchLarge(unsigned int size, unsigned int rectangles, bool mapped) {
+    pc::ClueList rows, columns;
+    cellsToClues(rectangleCells(size, rectangles, 11), size, size, rows, columns);
+    const char* gridPath = "picross-bench-grid.tmp";
+    const char* bmpPath = "picross-bench-large.tmp";
+
+    pc::Grid grid;
+    if (!mapped) grid.resize(size, size);
+    else if (!grid.resizeMapped(size, size, gridPath)) {
+        std::cerr << "Could not map " << gridPath << "." << std::endl;
+        return;
+    }
+    pc::ThreadPool pool(1);
+    pc::SolveOptions options;
+    options.parallelSweep = true;
+    options.pool = &pool;
+    pc::SolveStats stats;
+    auto start = benchClock::now();
+    const pc::Status status = solvePicross(grid, rows, columns, options, &stats);
+    const double solveSeconds = secondsSince(start);
+    start = benchClock::now();
+    bm::Array2dToBMP(grid, bmpPath, 1);
+    const double bmpSeconds = secondsSince(start);
+    const double bitsPerCell = 8.0 * grid.memoryUsage() / (double(size) * size);
+    grid.resize(0, 0);
+    std::remove(gridPath);
+    std::remove(bmpPath);
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    std::cout << std::setw(5) << size << "x" << std::left << std::setw(6) << size << std::right
+              << std::setw(9) << (mapped ? "mapped" : "heap") << std::setw(10) << pc::statusName(status)
+              << std::setw(12) << stats.lineSolves << std::setw(12) << std::fixed << std::setprecision(0)
+              << solveSeconds * 1e3 << std::setw(12) << std::setprecision(2) << bitsPerCell
+              << std::setw(10) << std::setprecision(1) << bmpSeconds * 1e3 << std::setw(10)
+              << usage.ru_maxrss / 1024 << std::endl;
+}
+
+/*
+ * Solves a random puzzle of every size the fixed-size solvers cover, and of
+ * sizes next to them, with search; each must come out solved. False if one
+ * does not, as when a size is dispatched to the solver for another.
+ */
+static bool checkFixedSizes() {
+    const unsigned int sizes[][2] = {{5, 5}, {5, 10}, {5, 15}, {10, 5}, {10, 10}, {10, 15}, {15, 5}, {15, 10},
+                                     {15, 15}, {4, 105}, {9, 110}, {14, 115}, {5, 6}, {7, 15}, {15, 16}};
+    pc::SolveOptions options;
+    options.search = true;
+    bool ok = true;
+    for (const auto& size : sizes) {
+        for (unsigned int seed = 0; seed < 5; seed++) {
+            pc::ClueList rows, columns;
+            makePuzzle(size[0], size[1], 0.6, 12000 + seed, rows, columns);
+            pc::Grid grid(size[0], size[1]);
+            const pc::Status status = solvePicross(grid, rows, columns, options);
+            if (status == pc::SOLVED) continue;
+            std::cerr << size[0] << "x" << size[1] << " puzzle " << seed << ": " << pc::statusName(status)
+                      << ", expected solved" << std::endl;
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+static bool runCorpus(const char* jsonFile) {
+    if (!checkFixedSizes()) return false;
+    const std::vector<CorpusSuite> suites = buildCorpus();
+    std::cout << std::left << std::setw(21) << "suite" << std::right << std::setw(8) << "puzzles"
+              << std::setw(8) << "solved" << std::setw(12) << "median us" << std::setw(12) << "p99 us"
+              << std::setw(12) << "puzzles/s" << std::setw(12) << "allocs/pz" << std::setw(12) << "KiB/pz"
+              << std::setw(10) << "peak MiB" << std::endl;
+    std::string json = "[";
+    for (const CorpusSuite& suite : suites) benchCorpus(suite, json);
+    json += "\n  ]";
+    if (!jsonFile) return true;
+    std::ofstream out(jsonFile);
+    out << "{\n  \"compiler\": \"" << __VERSION__ << "\",\n  \"line_kernel\": \"" << pc::lineKernelName()
+        << "\",\n  \"suites\": " << json << "\n}\n";
+    if (!out.good()) {
+        std::cerr << "Could not write " << jsonFile << "." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    const char* jsonFile = nullptr;
+    std::vector<std::string> sections;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--json") && i + 1 < argc) jsonFile = argv[++i];
+        else sections.push_back(argv[i]);
+    }
+    auto run = [&](const char* section) {
+        return sections.empty() || std::find(sections.begin(), sections.end(), section) != sections.end();
+    };
+
+    if (run("grid")) {
+        std::cout << std::setw(11) << std::left << "grid" << std::right
+                  << std::setw(12) << "legacy B" << std::setw(12) << "packed B"
+                  << std::setw(14) << "legacy Mc/s" << std::setw(14) << "packed Mc/s" << std::endl;
+        benchGrid(25, 20000);
+        benchGrid(100, 2000);
+        benchGrid(1000, 20);
+        benchGrid(4000, 2);
+    }
+
+    if (run("propagation")) {
+        std::cout << std::endl << std::setw(11) << std::left << "puzzle" << std::right
+                  << std::setw(9) << "density" << std::setw(10) << "queue" << std::setw(14) << "solved"
+                  << std::setw(14) << "line solves" << std::setw(12) << "per line" << std::setw(12) << "ms/puzzle" << std::endl;
+        benchPropagation(30, 0.6, 50);
+        benchPropagation(100, 0.6, 10);
+        benchPropagation(300, 0.7, 3);
+    }
+
+    if (run("search")) {
+        std::cout << std::endl << std::setw(11) << std::left << "puzzle" << std::right
+                  << std::setw(9) << "threads" << std::setw(12) << "nodes" << std::setw(12) << "solutions"
+                  << std::setw(12) << "ms/puzzle" << std::setw(10) << "speedup" << std::endl;
+        benchSearch(20, 0.5, 4);
+    }
+
+    if (run("sweep")) {
+        std::cout << std::endl << std::setw(11) << std::left << "puzzle" << std::right
+                  << std::setw(9) << "threads" << std::setw(14) << "status" << std::setw(12) << "line solves"
+                  << std::setw(12) << "ms" << std::setw(10) << "speedup" << std::endl;
+        benchSweep(400, 0.8);
+    }
+
+    if (run("parse")) {
+        std::cout << std::endl << std::setw(11) << std::left << "puzzle" << std::right
+                  << std::setw(10) << "format" << std::setw(10) << "puzzles" << std::setw(14) << "puzzles/s"
+                  << std::setw(10) << "MB/s" << std::endl;
+        benchParse(15, 100000, false);
+        benchParse(15, 100000, true);
+        benchParse(100, 2000, false);
+    }
+
+    if (run("session")) {
+        std::cout << std::endl << std::setw(11) << std::left << "puzzle" << std::right
+                  << std::setw(9) << "density" << std::setw(12) << "cold ms" << std::setw(14) << "ms/edit"
+                  << std::setw(12) << "re-solve ms" << std::setw(10) << "speedup" << std::endl;
+        benchSession(30, 0.65, 200);
+        benchSession(64, 0.65, 100);
+        benchSession(200, 0.65, 20);
+        benchSession(500, 0.7, 5);
+    }
+
+    if (run("cache")) {
+        std::cout << std::endl << std::left << std::setw(21) << "suite" << std::right << std::setw(8) << "puzzles"
+                  << std::setw(12) << "plain ms" << std::setw(12) << "cached ms" << std::setw(12) << "lookups"
+                  << std::setw(8) << "hit %" << std::setw(10) << "speedup" << std::endl;
+        for (const CorpusSuite& suite : buildCorpus()) {
+            if (suite.name == "random-density" || suite.name.compare(0, 6, "multi-") == 0) benchCache(suite);
+        }
+    }
+
+    if (run("budget")) {
+        std::cout << std::endl << std::left << std::setw(21) << "suite" << std::right << std::setw(8) << "puzzles"
+                  << std::setw(12) << "plain ms" << std::setw(12) << "limited ms" << std::setw(12) << "overhead %"
+                  << std::endl;
+        for (const CorpusSuite& suite : buildCorpus()) {
+            if (suite.name == "random-density" || suite.name.compare(0, 6, "multi-") == 0) benchBudget(suite);
+        }
+        benchDeadline(30, 1, 10);
+        benchDeadline(30, 4, 10);
+        benchDeadline(100, 1, 50);
+        bool reports = true;
+        for (unsigned long long stepLimit : {100, 1000, 5000}) {
+            reports = checkStepReport(30, true, false, stepLimit) && reports;
+            reports = checkStepReport(30, true, true, stepLimit) && reports;
+        }
+        for (unsigned long long stepLimit : {100, 150}) reports = checkStepReport(100, false, false, stepLimit) && reports;
+        if (!reports) return 1;
+    }
+
+    if (run("probe")) {
+        std::cout << std::endl << std::left << std::setw(21) << "suite" << std::setw(12) << "deduction" << std::right
+                  << std::setw(8) << "puzzles" << std::setw(12) << "nodes" << std::setw(12) << "probes"
+                  << std::setw(12) << "median ms" << std::setw(12) << "p99 ms" << std::setw(12) << "total ms" << std::endl;
+        for (const CorpusSuite& suite : buildCorpus()) {
+            if (suite.name == "random-30" || suite.name == "random-100" || suite.name == "random-density" ||
+                suite.name.compare(0, 6, "multi-") == 0) benchProbe(suite);
+        }
+        for (unsigned int size : {30, 35}) {
+            CorpusSuite hard{"random-" + std::to_string(size) + "-sparse", {}, 2, 1};
+            for (unsigned int seed = 0; seed < 40; seed++) hard.puzzles.push_back(randomPuzzle(size, 0.55, 8000 + seed));
+            benchProbe(hard);
+        }
+    }
+
+    if (run("placements")) {
+        std::cout << std::endl;
+        benchPlacements();
+    }
+
+    if (run("output")) {
+        std::cout << std::endl << std::setw(11) << std::left << "puzzle" << std::right
+                  << std::setw(10) << "format" << std::setw(10) << "puzzles" << std::setw(12) << "B/puzzle"
+                  << std::setw(12) << "puzzles/s" << std::setw(10) << "MB/s" << std::setw(10) << "stalls" << std::endl;
+        benchOutput(15, 0.6, 100000);
+        benchOutput(100, 0.6, 2000);
+        benchOutput(400, 0.7, 50);
+    }
+
+    if (run("batch")) {
+        std::cout << std::endl << std::setw(11) << std::left << "puzzle" << std::right
+                  << std::setw(9) << "threads" << std::setw(10) << "puzzles" << std::setw(10) << "solved"
+                  << std::setw(12) << "puzzles/s" << std::setw(14) << "allocations" << std::setw(12) << "per puzzle"
+                  << std::endl;
+        for (unsigned int threads : {1, 4}) {
+            benchBatch(15, 0.6, 10000, threads);
+            benchBatch(15, 0.6, 40000, threads);
+        }
+    }
+
+    if (run("large")) {
+        std::cout << std::endl << std::setw(11) << std::left << "puzzle" << std::right
+                  << std::setw(9) << "grid" << std::setw(10) << "status" << std::setw(12) << "line solves"
+                  << std::setw(12) << "solve ms" << std::setw(12) << "bits/cell" << std::setw(10) << "bmp ms"
+                  << std::setw(10) << "peak MiB" << std::endl;
+        benchLarge(4000, 600, false);
+        benchLarge(4000, 600, true);
+    }
+
+    if (run("corpus")) {
+        std::cout << std::endl;
+        if (!runCorpus(jsonFile)) return 1;
+    }
+    return 0;
+}
@@ -4,448 +4,481 @@
  * Author: Caleb Geyer (http://www.github.com/gaiablade/)
  *   Date: February 8th, 2020
  */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <sys/resource.h>
+#include <unistd.h>
 #include <vector>
-#include <set>
-#include <iterator>
-#include <fstream>
+#include "Batch.h"
 #include "Bitmap.h"
+#include "Generator.h"
+#include "Grid.h"
+#include "LineCache.h"
+#include "PlacementTable.h"
+#include "Server.h"
+#include "SolutionFile.h"
+#include "Solver.h"
+#include "ThreadPool.h"
+
+/*
+ * Solves one puzzle and prints the grid, or why it could not be finished.
+ */
+static void solve(pc::Grid& picross, const pc::Puzzle& puzzle) {
+    const pc::Status status = solvePicross(picross, puzzle);
+    if (status != pc::SOLVED) std::cout << pc::statusName(status) << ":" << std::endl;
+    printPicross(picross);
+}
 
-void solvePicross(unsigned int width, unsigned int height, unsigned int** picross, std::vector<unsigned int> rows[5], std::vector<unsigned int> columns[5]) {
-
-    std::set<unsigned int> unFilledRows;
-    std::set<unsigned int> unFilledColumns;
-    for (int i = 0; i < height; i++) unFilledRows.insert(i);
-    for (int i = 0; i < width; i++) unFilledColumns.insert(i);
-
-    auto printPicross = [&]() {
-        for (int column = 0; column < width; column++) {
-            for (int row = 0; row < height; row++)
-                std::cout << picross[column][row] << " ";
-            std::cout << std::endl;
+/*
+ * picross-solver --batch [file] [--threads N] [--unordered] [--search] [--probe] [--stats file] [--cache MB]
+ *                [--placements table] [--solutions file [--per-file N]] [--time-limit ms] [--step-limit N]
+ * Solves every puzzle in file (or stdin when file is - or missing), see
+ * Batch.h and Puzzle.h for the formats. --probe probes cells when line logic
+ * gets stuck, before searching (see Probe.h). --stats writes a JSON line of solve
+ * statistics per puzzle to file. --cache shares a line cache of about MB
+ * megabytes between all puzzles and threads (see LineCache.h). --placements
+ * maps a table written by --build-placements and solves the lines it covers
+ * from it (see PlacementTable.h). --solutions writes binary solution records
+ * to file instead of text to stdout, starting a new file every N records
+ * with --per-file (see SolutionFile.h). --time-limit and --step-limit stop
+ * each puzzle after ms milliseconds or N line solves, leaving it "stopped"
+ * with the cells proven so far.
+ */
+static int runBatch(int argc, char** argv) {
+    pc::BatchOptions options;
+    const char* filename = "-";
+    const char* statsFile = nullptr;
+    const char* placementsFile = nullptr;
+    const char* solutionsFile = nullptr;
+    pc::SolutionWriterOptions solutionOptions;
+    unsigned int cacheMegabytes = 0;
+    for (int i = 2; i < argc; i++) {
+        if (!strcmp(argv[i], "--threads") && i + 1 < argc) options.threads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--unordered")) options.ordered = false;
+        else if (!strcmp(argv[i], "--search")) options.solve.search = true;
+        else if (!strcmp(argv[i], "--probe")) options.solve.deduction = pc::PROBING;
+        else if (!strcmp(argv[i], "--stats") && i + 1 < argc) statsFile = argv[++i];
+        else if (!strcmp(argv[i], "--cache") && i + 1 < argc) cacheMegabytes = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--placements") && i + 1 < argc) placementsFile = argv[++i];
+        else if (!strcmp(argv[i], "--solutions") && i + 1 < argc) solutionsFile = argv[++i];
+        else if (!strcmp(argv[i], "--per-file") && i + 1 < argc) solutionOptions.recordsPerFile = atoll(argv[++i]);
+        else if (!strcmp(argv[i], "--time-limit") && i + 1 < argc) options.timeLimit = std::chrono::milliseconds(atoll(argv[++i]));
+        else if (!strcmp(argv[i], "--step-limit") && i + 1 < argc) options.solve.stepLimit = atoll(argv[++i]);
+        else if (argv[i][0] != '-' || !strcmp(argv[i], "-")) filename = argv[i];
+        else {
+            // A misspelled option, or one missing its value at the end.
+            std::cerr << "Unknown or incomplete --batch option " << argv[i] << "." << std::endl;
+            return 1;
         }
-        std::cout << std::endl;
-    };
-
-    auto printVector = [](const std::vector<unsigned int>& vec) {
-        for (auto& v : vec) {
-            std::cout << v << " ";
+    }
+    std::ofstream stats;
+    if (statsFile) {
+        stats.open(statsFile);
+        if (stats.fail()) {
+            std::cerr << "Could not write " << statsFile << "." << std::endl;
+            return 1;
         }
-        std::cout << std::endl;
-        std::cin.get();
-    };
-
-    /*
-     * Returns the sum of the vector plus 1 for each gap.
-     */
-    auto sumRC = [&](const std::vector<unsigned int>& vec) {
-        unsigned int sum = 0;
-        for (auto& u : vec) sum += u;
-        sum += vec.size() - 1;
-        return sum;
-    };
-
-    /*
-     * Returns the sum of the vector.
-     */
-    auto sumVector = [](const std::vector<unsigned int>& vec) {
-        unsigned int sum = 0;
-        for (auto& v : vec) sum += v;
-        return sum;
-    };
-
-    // Check if the sum of each row is equal to the expected sum.
-    auto isSolved = [&]() {
-        if (unFilledColumns.empty() && unFilledRows.empty()) {
-            return true;
+        options.statsOut = &stats;
+    }
+    std::unique_ptr<pc::LineCache> cache;
+    if (cacheMegabytes) {
+        cache.reset(new pc::LineCache(size_t(cacheMegabytes) << 20));
+        options.solve.lineCache = cache.get();
+    }
+    pc::PlacementTable placements;
+    if (placementsFile) {
+        if (!placements.load(placementsFile)) {
+            std::cerr << placements.getError() << "." << std::endl;
+            return 1;
         }
-        return false;
-    };
-
-    auto firstSweep = [&](unsigned char crs) {
-        // crs = 0: columns, crs = 1: rows
-        const unsigned int wh = (crs) ? height : width; // wh: width or height
-
-        // crv is a handle to the vector or row or column values.
-        const std::vector<unsigned int>* crv = (crs) ? &rows[0] : &columns[0]; // crv: column or row vector
-
-        for (int cr = 0; cr < wh; cr++) { // cr: column or row
-            //printVector(crv[cr]);
-            const unsigned int sum = sumRC(crv[cr]);
-            // If the sum of the row/column (e.g. {2, 2} = 2 + 1(gap) + 2 = 5)
-            // equals the width/height, there is only one solution to that
-            // row/column:
-            if (sum == 0) {
-                for (int i = 0; i < wh; i++) {
-                    if (crs) {
-                        picross[cr][i] = 2;
-                    }
-                    else {
-                        picross[i][cr] = 2;
-                    }
-                }
-            }
-            else if (sum == wh) {
-                std::vector<uint8_t> guarenteedLayout;
-                for (int i = 0; i < crv[cr].size(); i++) {
-                    for (int j = 0; j < crv[cr][i]; j++) {
-                        guarenteedLayout.push_back(1);
-                    }
-                    guarenteedLayout.push_back(0);
-                }
-                for (int i = 0; i < wh; i++) {
-                    if (crs) {
-                        picross[cr][i] = guarenteedLayout[i];
-                    }
-                    else {
-                        picross[i][cr] = guarenteedLayout[i];
-                    }
-                }
-            }
-            // If a block is larger than the largest possible gap, fill in the
-            // tiles that are guarenteed:
-            else {
-                int largestGap = wh - sum;
-                if (crv[cr].size() > 1) {
-                    largestGap++;
-                }
-                std::vector<uint8_t> guarenteedLayout;
-                for (int i = 0; i < crv[cr].size(); i++) {
-                    if (crv[cr][i] >= largestGap) {
-                        if (crv[cr][i] == largestGap) {
-                            for (int j = 0; j < crv[cr][i] + 1 - largestGap; j++) {
-                                guarenteedLayout.push_back(0);
-                            }
-                            guarenteedLayout.push_back(1);
-                        }
-                        else {
-                            for (int j = 0; j < largestGap; j++) {
-                                guarenteedLayout.push_back(0);
-                            }
-                            for (int j = 0; j < crv[cr][i] - largestGap; j++) {
-                                guarenteedLayout.push_back(1);
-                            }
-                        }
-                    }
-                    else {
-                        for (int j = 0; j < crv[cr][i]; j++) {
-                            guarenteedLayout.push_back(0);
-                        }
-                        guarenteedLayout.push_back(0);
-                    }
-                }
-                for (int i = 0; i < wh; i++) {
-                    if (crs) {
-                        if (!picross[cr][i]) {
-                            picross[cr][i] = guarenteedLayout[i];
-                        }
-                    }
-                    else {
-                        if (!picross[i][cr]) {
-                            picross[i][cr] = guarenteedLayout[i];
-                        }
-                    }
-                }
-            }
+        options.solve.placements = &placements;
+    }
+    pc::SolutionWriter solutions;
+    if (solutionsFile) {
+        if (!solutions.open(solutionsFile, solutionOptions)) {
+            std::cerr << solutions.getError() << "." << std::endl;
+            return 1;
         }
-    };
+        options.solutionsOut = &solutions;
+    }
+    pc::PuzzleReader reader;
+    if (!reader.open(filename)) {
+        std::cerr << "Could not open " << filename << "." << std::endl;
+        return 1;
+    }
+    std::ios_base::sync_with_stdio(false);
+    const pc::BatchSummary summary = pc::solveBatch(reader, std::cout, options);
+    if (solutionsFile) {
+        if (!solutions.close()) {
+            std::cerr << solutions.getError() << "." << std::endl;
+            return 1;
+        }
+        const pc::SolutionWriterCounters& counters = solutions.getCounters();
+        std::cerr << "solutions: " << counters.records << " records, " << counters.bytes << " bytes in "
+                  << counters.files << (counters.files == 1 ? " file" : " files") << std::endl;
+    }
+    std::cerr << summary.puzzles << " puzzles: " << summary.solved << " solved, " << summary.stuck << " stuck, "
+              << summary.contradictions << " contradictions";
+    if (summary.stopped) std::cerr << ", " << summary.stopped << " stopped";
+    std::cerr << std::endl;
+    if (cache) {
+        const pc::SolveStats& stats = summary.stats;
+        std::cerr << "line cache: " << stats.cacheHits << " hits in " << stats.cacheLookups << " lookups ("
+                  << (stats.cacheLookups ? 100 * stats.cacheHits / stats.cacheLookups : 0) << "%), "
+                  << cache->getCounters().evictions << " evictions" << std::endl;
+    }
+    if (!reader.getError().empty()) {
+        std::cerr << filename << ": " << reader.getError() << std::endl;
+        return 1;
+    }
+    return 0;
+}
 
-    /*
-     * Check if an entire row/column is complete and fill the gaps.
-     */
-    auto checkCompletedRC = [&](unsigned char crs) {
-        const unsigned int wh = crs ? height : width;
-        const std::vector<unsigned int>* rc = crs ? &rows[0] : &columns[0];
-        std::set<unsigned int>& s = crs ? unFilledRows : unFilledColumns;
-        for (int i = 0; i < wh; i++) { // for each row/column
-            bool complete = true;
-            for (int j = 0; j < wh; j++) { // for each tile in row/column
-                if (rc[i][j] == 0) {
-                    complete = false;
-                    break;
-                }
-            }
-            if (complete) {
-                s.erase(i);
-            }
+/*
+ * picross-solver --serve [--socket path] [--threads N] [--search] [--probe] [--cache MB] [--placements table]
+ *                [--time-limit ms] [--step-limit N]
+ * Answers solve requests on stdin/stdout until the end of input, or from
+ * every client of a Unix domain socket at path until killed; see Server.h
+ * for the protocol. The options are the defaults of every request, and the
+ * thread pool, line cache and placement table are kept for all of them.
+ */
+static int runServe(int argc, char** argv) {
+    pc::ServerOptions options;
+    const char* socketPath = nullptr;
+    const char* placementsFile = nullptr;
+    unsigned int cacheMegabytes = 0;
+    for (int i = 2; i < argc; i++) {
+        if (!strcmp(argv[i], "--socket") && i + 1 < argc) socketPath = argv[++i];
+        else if (!strcmp(argv[i], "--threads") && i + 1 < argc) options.threads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--search")) options.solve.search = true;
+        else if (!strcmp(argv[i], "--probe")) options.solve.deduction = pc::PROBING;
+        else if (!strcmp(argv[i], "--cache") && i + 1 < argc) cacheMegabytes = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--placements") && i + 1 < argc) placementsFile = argv[++i];
+        else if (!strcmp(argv[i], "--time-limit") && i + 1 < argc) options.timeLimit = std::chrono::milliseconds(atoll(argv[++i]));
+        else if (!strcmp(argv[i], "--step-limit") && i + 1 < argc) options.solve.stepLimit = atoll(argv[++i]);
+        else {
+            std::cerr << "Unknown --serve option " << argv[i] << "." << std::endl;
+            return 1;
         }
-        for (std::set<unsigned int>::iterator cr = s.begin(); cr != s.end(); cr++) {
-            unsigned int expectedSum = sumVector(rc[*cr]);
-            unsigned int actualSum = 0;
-            for (int i = 0; i < wh; i++) actualSum += (crs) ? (picross[*cr][i] == 1 ? 1 : 0) : (picross[i][*cr] == 1 ? 1 : 0);
-            if (actualSum == expectedSum) {
-                // set unfilled squares to 0 (X)
-                if (crs) { // rows
-                    for (int i = 0; i < wh; i++)
-                        if (!picross[*cr][i]) picross[*cr][i] = 2;
-                }
-                else {
-                    for (int i = 0; i < wh; i++)
-                        if (!picross[i][*cr]) picross[i][*cr] = 2;
-                }
-                s.erase(cr);
-                if (!s.empty()) cr = s.begin();
-            }
+    }
+    std::unique_ptr<pc::LineCache> cache;
+    if (cacheMegabytes) {
+        cache.reset(new pc::LineCache(size_t(cacheMegabytes) << 20));
+        options.solve.lineCache = cache.get();
+    }
+    pc::PlacementTable placements;
+    if (placementsFile) {
+        if (!placements.load(placementsFile)) {
+            std::cerr << placements.getError() << "." << std::endl;
+            return 1;
         }
-    };
+        options.solve.placements = &placements;
+    }
+    pc::Server server(options);
+    if (socketPath) {
+        server.listen(socketPath);
+        std::cerr << server.getError() << "." << std::endl;
+        return 1;
+    }
+    const bool ok = server.serve(STDIN_FILENO, STDOUT_FILENO);
+    const pc::ServerCounters counters = server.getCounters();
+    std::cerr << counters.requests << " requests: " << counters.errors << " errors, " << counters.stopped << " stopped"
+              << std::endl;
+    return ok ? 0 : 1;
+}
 
-    /*
-     * Check each row for possible gaps.
-     */
-    auto checkGaps = [&]() {
-        for (int i = 0; i < width; i++) {
-        }
+/*
+ * picross-solver --read-solutions <file> [id]...
+ * Prints the given records of a file written by --batch --solutions, or all
+ * of them in id order, as --batch would have printed them.
+ */
+static int runReadSolutions(int argc, char** argv) {
+    pc::SolutionReader reader;
+    if (argc < 3 || !reader.open(argv[2])) {
+        std::cerr << (argc < 3 ? "--read-solutions needs a file to read" : reader.getError()) << "." << std::endl;
+        return 1;
+    }
+    if (reader.wasRecovered()) std::cerr << argv[2] << " was not finished; read " << reader.size() << " records" << std::endl;
+    std::ios_base::sync_with_stdio(false);
+    pc::Grid picross;
+    std::string line;
+    auto print = [&](unsigned long long id, pc::Status status) {
+        line = std::to_string(id) + ' ' + pc::statusName(status) + ' ';
+        pc::appendGrid(line, picross);
+        line += '\n';
+        std::cout << line;
     };
-
-    auto treadRC = [&](unsigned int crs, std::vector<unsigned int> vec, unsigned int cr, unsigned int length) {
-        //printVector(vec);
-        unsigned int* firstTile  = crs ? &picross[cr][0]          : &picross[0][cr]; // first
-        unsigned int* lastTile   = crs ? &picross[cr][length - 1] : &picross[length - 1][cr]; // last
-        unsigned int* secondTile = crs ? &picross[cr][1]          : &picross[1][cr];
-        unsigned int* thirdTile  = crs ? &picross[cr][2]          : &picross[2][cr];
-        unsigned int* ntlTile    = crs ? &picross[cr][length - 2] : &picross[length - 2][cr]; // next-to-last tile
-        unsigned int* nttlTile   = crs ? &picross[cr][length - 3] : &picross[length - 3][cr];
-        /*
-         * If first tile in row/column is filled:
-         */
-        if (*firstTile == 1) {
-            for (int i = 1; i < vec[0] - 1; i++) {
-                unsigned int* iterator = crs ? &picross[cr][i] : &picross[i][cr];
-                *iterator = 1;
-            }
-            vec.erase(vec.begin());
-        }
-        /*
-         * If the last tile in row/column is filled:
-         */
-        if (*lastTile == 1) {
-            for (int i = length - 1; i > length - 1 - vec.back(); i--) {
-                unsigned int* iterator = crs ? &picross[cr][i] : &picross[i][cr];
-                *iterator = 1;
-            }
-            vec.pop_back();
-        }
-        /*
-         * If first tile is crossed and the second tile is filled:
-         */
-        if (*firstTile == 2 && *secondTile == 1) {
-            int i = 0;
-            for (i = 0; i < vec[0]; i++) {
-                unsigned int* iterator = crs ? &picross[cr][i + 1] : &picross[i + 1][cr];
-                *iterator = 1;
-            }
-            if (i + 1 < length) {
-                unsigned int* iterator = crs ? &picross[cr][i + 1] : &picross[i + 1][cr];
-                *iterator = 2;
-            }
-            vec.erase(vec.begin());
-        }
-        /*
-         * If last tile is crossed and the next to last tile is filled:
-         */
-        if (*lastTile == 2 && *ntlTile == 1) {
-            for (int i = 0; i < vec.back(); i++) {
-                //ntlTile[-i] = 1;
-                unsigned int* iterator = crs ? &picross[cr][length - 2 - i] : &picross[length - 2 - i][cr];
-                *iterator = 1;
-            }
-            vec.pop_back();
-        }
-        if (*firstTile == 0 && *secondTile == 1 && *thirdTile == 2) {
-            for (int i = 0; i < vec[0]; i++) {
-                unsigned int* iterator = crs ? &picross[cr][1 + i] : &picross[i + 1][cr];
-                *iterator = 1;
+    unsigned long long id;
+    pc::Status status;
+    if (argc == 3) {
+        for (size_t i = 0; i < reader.size(); i++) {
+            if (!reader.read(i, id, status, picross)) {
+                std::cerr << argv[2] << ": damaged record" << std::endl;
+                return 1;
             }
-            *firstTile = *firstTile == 1 ? 1 : 2;
-            vec.erase(vec.begin());
+            print(id, status);
         }
-        if (*lastTile == 0 && *ntlTile == 1 && *nttlTile == 2) {
-            for (int i = 0; i < vec.back(); i++) {
-                unsigned int* iterator = crs ? &picross[cr][length - 2 + i] : &picross[length - 2 + i][cr];
-                *iterator = 1;
-            }
-            *lastTile = *lastTile == 1 ? 1 : 2;
-            vec.pop_back();
+    }
+    for (int i = 3; i < argc; i++) {
+        id = strtoull(argv[i], nullptr, 10);
+        if (!reader.find(id, status, picross)) {
+            std::cerr << argv[2] << ": no record for " << id << std::endl;
+            return 1;
         }
+        print(id, status);
+    }
+    return 0;
+}
 
-        /*
-         * Count how many remaining empty tiles and resolve them:
-         */
-        unsigned int remainingEmpty = 0;
-        for (int i = 0; i < length; i++) {
-            unsigned int* tile = crs ? &picross[cr][i] : &picross[i][cr];
-            if (*tile == 0) {
-                remainingEmpty++;
-            }
-        }
-        if (remainingEmpty == sumRC(vec) && vec.size() == 1) {
-            int number = 0;
-            unsigned int* iterator = crs ? &picross[cr][number] : &picross[number][cr];
-            while (*iterator) {
-                number++;
-                iterator = crs ? &picross[cr][number] : &picross[number][cr];
-            }
-            for (int i = 0; i < vec[0]; i++) {
-                *iterator = 1;
-                number++;
-                iterator = crs ? &picross[cr][number] : &picross[number][cr];
+/*
+ * picross-solver --generate <image|directory>... [--size WxH | --width N | --height N]
+ *                [--threshold T] [--unique] [--non] [--out directory] [--threads N]
+ * Turns BMP images into puzzles, see Generator.h. Clues go to stdout unless
+ * --out names a directory for one clue file per image.
+ */
+static int runGenerate(int argc, char** argv) {
+    pc::GenerateOptions options;
+    std::vector<std::string> paths;
+    for (int i = 2; i < argc; i++) {
+        if (!strcmp(argv[i], "--size") && i + 1 < argc) {
+            if (sscanf(argv[++i], "%ux%u", &options.width, &options.height) != 2) {
+                std::cerr << "Bad --size " << argv[i] << ", expected WxH." << std::endl;
+                return 1;
             }
         }
+        else if (!strcmp(argv[i], "--width") && i + 1 < argc) options.width = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--height") && i + 1 < argc) options.height = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--threshold") && i + 1 < argc) options.threshold = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--threads") && i + 1 < argc) options.threads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--out") && i + 1 < argc) options.outputDirectory = argv[++i];
+        else if (!strcmp(argv[i], "--unique")) options.unique = true;
+        else if (!strcmp(argv[i], "--non")) options.non = true;
+        else paths.push_back(argv[i]);
+    }
+    std::vector<std::string> files;
+    std::string error;
+    if (!pc::listImages(paths, files, error)) {
+        std::cerr << error << "." << std::endl;
+        return 1;
+    }
+    std::ios_base::sync_with_stdio(false);
+    const pc::GenerateSummary summary = pc::generatePuzzles(files, std::cout, options);
+    std::cerr << summary.images << " images: " << summary.written << " puzzles written, " << summary.notUnique
+              << " not unique, " << summary.failed << " failed" << std::endl;
+    return summary.failed ? 1 : 0;
+}
 
-        int iterator = 0;
-        while (iterator < length && *(crs ? &picross[cr][iterator] : &picross[iterator][cr]) != 1) {
-            iterator++;
-        }
-        int iterator2 = iterator;
-        while (iterator2 < length && *(crs ? &picross[cr][iterator2] : &picross[iterator2][cr]) == 1) {
-            iterator2++;
-        }
-        if (iterator > 0 && iterator < length && iterator2 < length && *(crs ? &picross[cr][iterator2] : &picross[iterator2][cr]) == 0) {
-            if ((crs ? picross[cr][iterator - 1] : picross[iterator - 1][cr]) == 2) {
-                int i;
-                for (i = 0; i < vec[0]; i++) {
-                    if (crs) {
-                        picross[cr][iterator + i] = 1;
-                    }
-                    else {
-                        picross[iterator + i][cr] = 1;
-                    }
-                }
-                (crs ? picross[cr][iterator + i] : picross[iterator + i][cr]) = 2;
-            }
-        }
-    };
+/*
+ * picross-solver --build-placements <file> [--length N]
+ * Writes the table of every filling of every clue for lines of up to N cells
+ * (default 20) to file, for --batch --placements. See PlacementTable.h.
+ */
+static int runBuildPlacements(int argc, char** argv) {
+    const char* filename = nullptr;
+    unsigned int length = 20;
+    for (int i = 2; i < argc; i++) {
+        if (!strcmp(argv[i], "--length") && i + 1 < argc) length = atoi(argv[++i]);
+        else filename = argv[i];
+    }
+    if (!filename) {
+        std::cerr << "--build-placements needs a file to write." << std::endl;
+        return 1;
+    }
+    pc::PlacementTable placements;
+    if (!placements.build(length)) {
+        std::cerr << placements.getError() << "." << std::endl;
+        return 1;
+    }
+    if (!placements.save(filename)) {
+        std::cerr << "Could not write " << filename << "." << std::endl;
+        return 1;
+    }
+    std::cerr << "lines of up to " << length << " cells: " << (placements.getBytes() >> 10) << " KiB" << std::endl;
+    return 0;
+}
 
-    firstSweep(0); // columns
-    firstSweep(1); // rows
-    firstSweep(0); // columns
-    checkCompletedRC(0);
-    checkCompletedRC(1);
-    while (!isSolved()) {
-        for (auto i = unFilledColumns.begin(); i != unFilledColumns.end(); i++) {
-            treadRC(0, columns[*i], *i, width);
-        }
-        for (auto i = unFilledRows.begin(); i != unFilledRows.end(); i++) {
-            treadRC(1, rows[*i], *i, width);
+/*
+ * picross-solver --solve-large <file> [--grid-file path] [--bmp image] [--threads N] [--time-limit ms]
+ * Solves the first puzzle of file with line logic, for puzzles far too large
+ * to print, like 10000 x 10000. The clues are parsed straight from the mapped
+ * file and the grid holds four bits per cell; --grid-file keeps those in a
+ * file mapping instead of on the heap, so the kernel can page them out when
+ * the grid is larger than memory. Lines are propagated in sweeps, every row
+ * in order and then every column, so the grid is walked front to back
+ * rather than hopping between crossing lines. --bmp writes the result as a
+ * 1 bpp image a row at a time. Prints the status and where the time and
+ * memory went.
+ */
+static int runSolveLarge(int argc, char** argv) {
+    const char* filename = nullptr;
+    const char* gridFile = nullptr;
+    const char* bmpFile = nullptr;
+    pc::SolveOptions options;
+    std::chrono::milliseconds timeLimit(0);
+    for (int i = 2; i < argc; i++) {
+        if (!strcmp(argv[i], "--grid-file") && i + 1 < argc) gridFile = argv[++i];
+        else if (!strcmp(argv[i], "--bmp") && i + 1 < argc) bmpFile = argv[++i];
+        else if (!strcmp(argv[i], "--threads") && i + 1 < argc) options.threads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--time-limit") && i + 1 < argc) timeLimit = std::chrono::milliseconds(atoll(argv[++i]));
+        else filename = argv[i];
+    }
+    if (!filename) {
+        std::cerr << "--solve-large needs a puzzle file." << std::endl;
+        return 1;
+    }
+    auto start = std::chrono::steady_clock::now();
+    auto secondsSince = [](std::chrono::steady_clock::time_point since) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - since).count();
+    };
+    pc::PuzzleReader reader;
+    pc::Puzzle puzzle;
+    if (!reader.open(filename) || !reader.next(puzzle)) {
+        std::cerr << (reader.getError().empty() ? std::string("no puzzle in ") + filename : reader.getError()) << "." << std::endl;
+        return 1;
+    }
+    reader.close();
+    const double readSeconds = secondsSince(start);
+
+    pc::Grid picross;
+    if (!gridFile) picross.resize(puzzle.width, puzzle.height);
+    else if (!picross.resizeMapped(puzzle.width, puzzle.height, gridFile)) {
+        std::cerr << "Could not map a grid file at " << gridFile << "." << std::endl;
+        return 1;
+    }
+    // A pool, even of one thread, makes the solve sweep instead of queueing lines one by one.
+    pc::ThreadPool pool(options.threads);
+    options.pool = &pool;
+    options.parallelSweep = true;
+    pc::SolveStats stats;
+    start = std::chrono::steady_clock::now();
+    if (timeLimit.count()) options.deadline = start + timeLimit;
+    const pc::Status status = solvePicross(picross, puzzle.rows, puzzle.columns, options, &stats);
+    const double solveSeconds = secondsSince(start);
+
+    double bmpSeconds = 0;
+    if (bmpFile) {
+        start = std::chrono::steady_clock::now();
+        if (!bm::Array2dToBMP(picross, bmpFile, 1)) {
+            std::cerr << "Could not write " << bmpFile << "." << std::endl;
+            return 1;
         }
-        checkCompletedRC(0);
-        checkCompletedRC(1);
-        checkCompletedRC(0);
-        checkCompletedRC(1);
+        bmpSeconds = secondsSince(start);
     }
-    checkCompletedRC(0);
-    checkCompletedRC(1);
-    printPicross();
+    const unsigned long long cells = (unsigned long long)puzzle.width * puzzle.height;
+    unsigned long long known = 0;
+    for (unsigned int row = 0; row < picross.getHeight(); row++) known += picross.countKnown(pc::ROWS, row);
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    std::cerr << puzzle.width << "x" << puzzle.height << ": " << pc::statusName(status) << ", " << known << " of "
+              << cells << " cells known, " << stats.lineSolves << " line solves" << std::endl
+              << "read " << readSeconds << " s, solve " << solveSeconds << " s, bmp " << bmpSeconds << " s" << std::endl
+              << "grid " << (picross.memoryUsage() >> 20) << " MiB (" << 8.0 * picross.memoryUsage() / cells
+              << " bits/cell" << (gridFile ? ", mapped" : "") << "), clues "
+              << ((puzzle.rows.memoryUsage() + puzzle.columns.memoryUsage()) >> 10) << " KiB, peak RSS "
+              << (usage.ru_maxrss >> 10) << " MiB" << std::endl;
+    return status == pc::SOLVED ? 0 : 1;
 }
 
-int main() {
-    // picross[columns][rows]
-    unsigned int** picross = new unsigned int*[5];
-    for (int i = 0; i < 5; i++)
-        picross[i] = new unsigned int[5];
-
-    for (int i = 0; i < 5; i++)
-        for (int j = 0; j < 5; j++)
-            picross[i][j] = 0;
-
-    std::vector<unsigned int> rows[5];
-    std::vector<unsigned int> columns[5];
-
-    rows[0] = {2, 2};
-    rows[1] = {1};
-    rows[2] = {1, 2};
-    rows[3] = {1};
-    rows[4] = {4};
-
-    columns[0] = {1, 2};
-    columns[1] = {1, 1, 1};
-    columns[2] = {1};
-    columns[3] = {1, 1, 1};
-    columns[4] = {3};
-
-    solvePicross(5, 5, &picross[0], rows, columns);
-    bm::Array2dToBMP(&picross[0], 5, 5, "output1.bmp");
-
-    for (int i = 0; i < 5; i++)
-        for (int j = 0; j < 5; j++)
-            picross[i][j] = 0;
-
-    rows[0] = {1};
-    rows[1] = {5};
-    rows[2] = {2, 1};
-    rows[3] = {2, 1};
-    rows[4] = {1, 1};
-
-    columns[0] = {4};
-    columns[1] = {3};
-    columns[2] = {1};
-    columns[3] = {1, 1};
-    columns[4] = {4};
-
-    solvePicross(5, 5, &picross[0], rows, columns);
-    bm::Array2dToBMP(&picross[0], 5, 5, "output2.bmp");
-
-    for (int i = 0; i < 5; i++)
-        for (int j = 0; j < 5; j++)
-            picross[i][j] = 0;
-
-    rows[0] = {2};
-    rows[1] = {2, 1};
-    rows[2] = {1};
-    rows[3] = {1, 1};
-    rows[4] = {1, 1};
-
-    columns[0] = {0};
-    columns[1] = {2, 2};
-    columns[2] = {2};
-    columns[3] = {1, 1};
-    columns[4] = {1, 1};
-
-    solvePicross(5, 5, &picross[0], rows, columns);
-    bm::Array2dToBMP(&picross[0], 5, 5, "output3.bmp");
-
-    for (int i = 0; i < 5; i++)
-        for (int j = 0; j < 5; j++)
-            picross[i][j] = 0;
-
-    rows[0] = {1, 3};
-    rows[1] = {1, 1};
-    rows[2] = {2, 1};
-    rows[3] = {2, 1};
-    rows[4] = {3, 1};
-
-    columns[0] = {3, 1};
-    columns[1] = {3};
-    columns[2] = {1, 2};
-    columns[3] = {1};
-    columns[4] = {5};
-
-    solvePicross(5, 5, &picross[0], rows, columns);
-    bm::Array2dToBMP(&picross[0], 5, 5, "output4.bmp");
-
-    for (int i = 0; i < 5; i++)
-        for (int j = 0; j < 5; j++)
-            picross[i][j] = 0;
-
-    rows[0] = {2, 2};
-    rows[1] = {1, 2};
-    rows[2] = {1, 1};
-    rows[3] = {4};
-    rows[4] = {2, 1};
-
-    columns[0] = {5};
-    columns[1] = {1, 2};
-    columns[2] = {1, 1};
-    columns[3] = {5};
-    columns[4] = {1};
-
-    solvePicross(5, 5, &picross[0], rows, columns);
+int main(int argc, char** argv) {
+    if (argc > 1 && !strcmp(argv[1], "--batch")) return runBatch(argc, argv);
+    if (argc > 1 && !strcmp(argv[1], "--serve")) return runServe(argc, argv);
+    if (argc > 1 && !strcmp(argv[1], "--read-solutions")) return runReadSolutions(argc, argv);
+    if (argc > 1 && !strcmp(argv[1], "--generate")) return runGenerate(argc, argv);
+    if (argc > 1 && !strcmp(argv[1], "--build-placements")) return runBuildPlacements(argc, argv);
+    if (argc > 1 && !strcmp(argv[1], "--solve-large")) return runSolveLarge(argc, argv);
+
+    pc::Grid picross(5, 5);
+
+    pc::Puzzle puzzle;
+    puzzle.resize(5, 5);
+
+    puzzle.rows.set(0, {2, 2});
+    puzzle.rows.set(1, {1});
+    puzzle.rows.set(2, {1, 2});
+    puzzle.rows.set(3, {1});
+    puzzle.rows.set(4, {4});
+
+    puzzle.columns.set(0, {1, 2});
+    puzzle.columns.set(1, {1, 1, 1});
+    puzzle.columns.set(2, {1});
+    puzzle.columns.set(3, {1, 1, 1});
+    puzzle.columns.set(4, {3});
+
+    solve(picross, puzzle);
+    bm::Array2dToBMP(picross, "output1.bmp");
+
+    picross.clear();
+
+    puzzle.rows.set(0, {1});
+    puzzle.rows.set(1, {5});
+    puzzle.rows.set(2, {2, 1});
+    puzzle.rows.set(3, {2, 1});
+    puzzle.rows.set(4, {1, 1});
+
+    puzzle.columns.set(0, {4});
+    puzzle.columns.set(1, {3});
+    puzzle.columns.set(2, {1});
+    puzzle.columns.set(3, {1, 1});
+    puzzle.columns.set(4, {4});
+
+    solve(picross, puzzle);
+    bm::Array2dToBMP(picross, "output2.bmp");
+
+    picross.clear();
+
+    puzzle.rows.set(0, {2});
+    puzzle.rows.set(1, {2, 1});
+    puzzle.rows.set(2, {1});
+    puzzle.rows.set(3, {1, 1});
+    puzzle.rows.set(4, {1, 1});
+
+    puzzle.columns.set(0, {0});
+    puzzle.columns.set(1, {2, 2});
+    puzzle.columns.set(2, {2});
+    puzzle.columns.set(3, {1, 1});
+    puzzle.columns.set(4, {1, 1});
+
+    solve(picross, puzzle);
+    bm::Array2dToBMP(picross, "output3.bmp");
+
+    picross.clear();
+
+    puzzle.rows.set(0, {1, 3});
+    puzzle.rows.set(1, {1, 1});
+    puzzle.rows.set(2, {2, 1});
+    puzzle.rows.set(3, {2, 1});
+    puzzle.rows.set(4, {3, 1});
+
+    puzzle.columns.set(0, {3, 1});
+    puzzle.columns.set(1, {3});
+    puzzle.columns.set(2, {1, 2});
+    puzzle.columns.set(3, {1});
+    puzzle.columns.set(4, {5});
+
+    solve(picross, puzzle);
+    bm::Array2dToBMP(picross, "output4.bmp");
+
+    picross.clear();
+
+    puzzle.rows.set(0, {2, 2});
+    puzzle.rows.set(1, {1, 2});
+    puzzle.rows.set(2, {1, 1});
+    puzzle.rows.set(3, {4});
+    puzzle.rows.set(4, {2, 1});
+
+    puzzle.columns.set(0, {5});
+    puzzle.columns.set(1, {1, 2});
+    puzzle.columns.set(2, {1, 1});
+    puzzle.columns.set(3, {5});
+    puzzle.columns.set(4, {1});
+
+    solve(picross, puzzle);
     //picrossToBmp(5, 5, &picross[0], "output5.bmp");
-    bm::Array2dToBMP(&picross[0], 5, 5, "output5.bmp");
-
-    for (int i = 0; i < 5; i++)
-        delete[] picross[i];
-    delete[] picross;
+    bm::Array2dToBMP(picross, "output5.bmp");
 
     return 0;
 }